@@ -14,6 +14,8 @@ interface TgCommandsExecutor {
   onIncreaseThreshold(): Promise<void>;
 
   onDecreaseThreshold(): Promise<void>;
+
+  onSetSensitivity(a: CommandContextExtn): Promise<void>;
 }
 
 interface GlobalService extends FrameDetector, TgCommandsExecutor {
@@ -20,11 +20,13 @@ export class AppService implements GlobalService {
   async onIncreaseThreshold(): Promise<void> {
     this.im.conf.pixels = Math.ceil(this.im.conf.pixels * 2);
     await this.telegram.sendText(`Increase threshold to ${this.im.conf.pixels}`);
+    await this.reevaluateLastFrame();
   }
 
   async onDecreaseThreshold(): Promise<void> {
     this.im.conf.pixels = Math.ceil(this.im.conf.pixels / 2);
     await this.telegram.sendText(`Decreased threshold to ${this.im.conf.pixels}`);
+    await this.reevaluateLastFrame();
   }
 
   async onAskImage(): Promise<void> {
@@ -42,11 +44,22 @@ export class AppService implements GlobalService {
     const newThreshold = Number(a.payload);
     if (newThreshold > 0) {
       this.im.conf.pixels = newThreshold;
+      await this.reevaluateLastFrame();
     } else {
       await this.telegram.sendText(`${TelegramCommands.set_threshold} required number parameter. ${a.payload} is not a number`);
     }
   }
 
+  async onSetSensitivity(a: CommandContextExtn): Promise<void> {
+    const newThreshold = Number(a.payload);
+    if (a.payload?.trim() && newThreshold >= 0 && newThreshold <= 1) {
+      this.im.conf.threshold = newThreshold;
+      await this.reevaluateLastFrame();
+    } else {
+      await this.telegram.sendText(`${TelegramCommands.set_sensitivity} requires a number from 0 to 1. ${a.payload} is not one`);
+    }
+  }
+
   public async onNewFrame(frameData: FrameData): Promise<void> {
     const image = await this.im.getImageIfItsChanged(frameData);
     if (image) {
@@ -54,6 +67,14 @@ export class AppService implements GlobalService {
     }
   }
 
+  // A lower threshold may already be crossed by the frame on screen, don't wait for it to change again
+  private async reevaluateLastFrame(): Promise<void> {
+    const image = await this.im.reevaluateLastFrame();
+    if (image) {
+      await this.telegram.sendImage(image);
+    }
+  }
+
   async run(): Promise<void> {
     this.ss.listen(this);
     await this.telegram.setup(this);
@@ -31,6 +31,55 @@ const cameraSchema = z.object({
     .positive('Frame rate must be positive')
     .describe('🎬 Frame rate in frames per second')
     .default(1),
+  bufferCount: z.number()
+    .int()
+    .min(1, 'Buffer count must be at least 1')
+    .max(32, 'Buffer count must be at most 32')
+    .describe('🧺 Number of driver capture buffers (linux only)')
+    .optional(),
+  latestFrameOnly: z.boolean()
+    .describe('⚡ Skip queued frames and always process the newest one (linux only)')
+    .optional(),
+  minWidth: z.number()
+    .int()
+    .positive('Minimum width must be positive')
+    .describe('📐 Minimum frame width for detection, cheapest mode wins (linux only)')
+    .optional(),
+  minHeight: z.number()
+    .int()
+    .positive('Minimum height must be positive')
+    .describe('📐 Minimum frame height for detection, cheapest mode wins (linux only)')
+    .optional(),
+  decodeScale: z.union([z.literal(1), z.literal(2), z.literal(4), z.literal(8)])
+    .describe('🔬 Detect on frames scaled to 1/N size (linux only)')
+    .optional(),
+  grayscale: z.boolean()
+    .describe('🌑 Detect on luma only, RGB just for sent images (linux only)')
+    .optional(),
+  dctDetection: z.boolean()
+    .describe('🧮 Detect on MJPEG 8x8 block coefficients, skips decoding (linux only)')
+    .optional(),
+  conversionThreads: z.number()
+    .int()
+    .min(0, 'Conversion threads must not be negative')
+    .max(64, 'Conversion threads must be at most 64')
+    .describe('🧵 Threads converting raw frames, 0 is one per core up to 4 (linux only)')
+    .optional(),
+  stallTimeoutMs: z.number()
+    .int()
+    .min(100, 'Stall timeout must be at least 100ms')
+    .max(60000, 'Stall timeout must be at most 60000ms')
+    .describe('🔌 Milliseconds without frames before the camera is reopened (linux only)')
+    .optional(),
+  userPtr: z.boolean()
+    .describe('🧷 Capture into pool buffers so raw frames are lent out without copying (linux only)')
+    .optional(),
+  rawFrames: z.number()
+    .int()
+    .min(0, 'Raw frames must not be negative')
+    .max(32, 'Raw frames must be at most 32')
+    .describe('📦 Attach the undecoded source to every frame, up to N lent out at once (linux only)')
+    .optional(),
 });
 
 const diffSchema = z.object({
@@ -43,6 +92,18 @@ const diffSchema = z.object({
     .max(1, 'Threshold must be at most 1.0')
     .describe('🎯 Change sensitivity level, lower = more aggressive')
     .default(0.1),
+  scanOrder: z.enum(['linear', 'interleaved'])
+    .describe('🧭 Row order of the comparison, interleaved (default) finds large motion sooner')
+    .optional(),
+  workerThreads: z.number()
+    .int()
+    .min(0, 'Worker threads must not be negative')
+    .max(64, 'Worker threads must be at most 64')
+    .describe('🧵 Threads comparing and encoding images, 0 is one per core')
+    .optional(),
+  workerAffinity: z.array(z.number().int().min(0, 'CPU index must not be negative').max(1023, 'CPU index must be at most 1023'))
+    .describe('📌 CPUs the image threads are pinned to, round-robin')
+    .optional(),
 });
 
 const aconfigSchema = z.object({
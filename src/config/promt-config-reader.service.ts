@@ -71,6 +71,12 @@ export class PromptConfigReader {
       const currentPath = [...path, key];
       const fieldName = currentPath.join('.'); // Use dot notation like "telegram.token"
 
+      // eslint-disable-next-line 
+      if ((zodField._def as any).type === 'optional') {
+        // Optional fields are advanced tunables, they can only be set in the config file
+        continue;
+      }
+
       // eslint-disable-next-line 
       if ((zodField._def as any).typeName || zodField.shape !== undefined) {
         // Nested object - recurse with the nested schema
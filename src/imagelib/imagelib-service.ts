@@ -1,11 +1,21 @@
-import {Inject, Injectable, Logger} from '@nestjs/common';
-import {FrameData, INativeModule, Native} from '@/native/native-model';
+import {Inject, Injectable, Logger, OnModuleInit} from '@nestjs/common';
+import {FrameData, INativeModule, Native, NativeCompareOptions, NativeImageOptions} from '@/native/native-model';
 import {DiffConfData} from '@/config/config-resolve-model';
 import {DiffConfig} from '@/config/config-zod-schema';
 
 @Injectable()
-export class ImagelibService {
+export class ImagelibService implements OnModuleInit {
   private oldFrame: FrameData | null = null;
+  // Newest frame compared against oldFrame without alerting, the pair a threshold change is re-evaluated on,
+  // with its changed pixels at the per-pixel threshold they were counted for
+  private lastFrame: {frameData: FrameData; diffPixels: number; threshold: number} | null = null;
+  // At most one comparison runs, frames arriving meanwhile wait in a single slot where the newest replaces the rest
+  private inFlight: Promise<unknown> | null = null;
+  private pendingFrame: {
+    frameData: FrameData;
+    resolve: (image: Buffer | null) => void;
+    reject: (error: unknown) => void;
+  } | null = null;
 
   constructor(
     private readonly logger: Logger,
@@ -16,12 +26,23 @@ export class ImagelibService {
   ) {
   }
 
+  onModuleInit(): void {
+    // Must run before the first comparison, that one starts the threads with defaults
+    const threads = this.native.configureImageWorkers?.({
+      threads: this.conf.workerThreads,
+      affinity: this.conf.workerAffinity,
+    });
+    if (threads !== undefined) {
+      this.logger.log(`Comparing and encoding images on ${threads} native threads`);
+    }
+  }
+
   async getLastImage(): Promise<Buffer | null> {
     if (!this.oldFrame) {
       return null;
     }
 
-    return this.native.convertRgbToJpeg(this.oldFrame.buffer, this.oldFrame.width, this.oldFrame.height);
+    return this.encodeImage(this.oldFrame);
   }
 
   async getImageIfItsChanged(frameData: FrameData): Promise<Buffer | null> {
@@ -29,28 +50,158 @@ export class ImagelibService {
       return null;
     }
 
-    if (!this.oldFrame) {
-      this.oldFrame = frameData;
-      return null;
+    if (this.inFlight) {
+      // Latest wins: the frame this one supersedes is dropped without a comparison
+      this.pendingFrame?.resolve(null);
+      return new Promise((resolve, reject) => {
+        this.pendingFrame = {frameData, resolve, reject};
+      });
     }
 
-    const diffPixels = await this.native.compareRgbImages(
-      this.oldFrame.buffer,
-      frameData.buffer,
-      frameData.width,
-      frameData.height,
-      this.conf.threshold
-    );
+    return this.compareFrame(frameData);
+  }
+
+  private compareFrame(frameData: FrameData): Promise<Buffer | null> {
+    return this.exclusive(async() => {
+      if (!this.oldFrame) {
+        this.oldFrame = frameData;
+        return null;
+      }
 
-    if (diffPixels < this.conf.pixels) {
-      return null;
+      // Scaled frames count samples, diff.pixels is in capture resolution pixels
+      const scale = frameData.scale ?? 1;
+      const threshold = this.conf.threshold;
+      const diffSamples = await this.native.compareRgbImages(
+        this.oldFrame.buffer,
+        frameData.buffer,
+        frameData.width,
+        frameData.height,
+        threshold,
+        this.compareOptions(frameData, scale),
+      );
+      const diffPixels = diffSamples * scale * scale;
+
+      if (diffPixels < this.conf.pixels) {
+        // Below stopAfter the native count covers the whole frame, so it is exact
+        this.lastFrame = {frameData, diffPixels, threshold};
+        return null;
+      }
+
+      // The comparison stops at the alert count, so this is a lower bound
+      return this.alert(frameData, diffPixels);
+    });
+  }
+
+  /**
+   * Checks the last frame pair that didn't alert against the current diff settings, so a threshold command
+   * takes effect without waiting for the next change. A new diff.pixels is compared with the count the pair
+   * already has, only a new diff.threshold needs a native pass, one histogram that gives every threshold
+   */
+  async reevaluateLastFrame(): Promise<Buffer | null> {
+    // A frame started after the current job finishes is waited for as well
+    while (this.inFlight) {
+      await this.inFlight.catch(() => undefined);
+    }
+
+    return this.exclusive(async() => {
+      const last = this.lastFrame;
+      if (!this.oldFrame || !last) {
+        return null;
+      }
+
+      if (last.threshold !== this.conf.threshold) {
+        if (!this.native.compareRgbImagesHistogram) {
+          return null;
+        }
+        const histogram = await this.native.compareRgbImagesHistogram(
+          this.oldFrame.buffer,
+          last.frameData.buffer,
+          last.frameData.width,
+          last.frameData.height,
+          this.imageOptions(last.frameData),
+        );
+        const scale = last.frameData.scale ?? 1;
+        last.diffPixels = this.countChanged(histogram) * scale * scale;
+        last.threshold = this.conf.threshold;
+      }
+
+      if (last.diffPixels < this.conf.pixels) {
+        this.logger.log(`Last frame has ${last.diffPixels} changed pixels, below ${this.conf.pixels}`);
+        return null;
+      }
+
+      return this.alert(last.frameData, last.diffPixels);
+    });
+  }
+
+  // Comparisons and re-evaluations run one at a time, so two of them can't alert on the same change
+  private exclusive<T>(task: () => Promise<T>): Promise<T> {
+    const result = task();
+    this.inFlight = result;
+    const done = (): void => {
+      if (this.inFlight === result) {
+        this.inFlight = null;
+        this.startPendingFrame();
+      }
+    };
+    void result.then(done, done);
+    return result;
+  }
+
+  private startPendingFrame(): void {
+    const pending = this.pendingFrame;
+    if (!pending) {
+      return;
     }
+    this.pendingFrame = null;
+    this.compareFrame(pending.frameData).then(pending.resolve, pending.reject);
+  }
 
+  private async alert(frameData: FrameData, diffPixels: number): Promise<Buffer> {
     this.logger.log(`⚠️ CHANGE DETECTED: ${diffPixels} pixels`);
 
-    const jpegBuffer = await this.native.convertRgbToJpeg(frameData.buffer, frameData.width, frameData.height);
+    const jpegBuffer = await this.encodeImage(frameData);
 
     this.oldFrame = frameData;
+    this.lastFrame = null;
     return jpegBuffer;
   }
+
+  // Same cut as the native comparison: pixels whose difference is above threshold on the byte scale
+  private countChanged(histogram: Uint32Array): number {
+    let changed = 0;
+    for (let bin = Math.floor(this.conf.threshold * 255) + 1; bin < histogram.length; bin++) {
+      changed += histogram[bin];
+    }
+    return changed;
+  }
+
+  private async encodeImage(frameData: FrameData): Promise<Buffer> {
+    // Detection frames may be reduced or luma only, RGB at full resolution is only produced for images we send
+    if (this.native.captureSnapshot) {
+      try {
+        const snapshot = await this.native.captureSnapshot();
+        if (snapshot) {
+          this.logger.log(`📸 Full resolution snapshot ${snapshot.width}x${snapshot.height} in ${snapshot.switchMs.toFixed(1)}ms, restored in ${snapshot.restoreMs.toFixed(1)}ms`);
+          return await this.native.convertRgbToJpeg(snapshot.buffer, snapshot.width, snapshot.height, this.imageOptions(snapshot));
+        }
+      } catch (error) {
+        this.logger.warn(`Full resolution snapshot failed, sending detection frame: ${(error as Error).message}`);
+      }
+    }
+    return this.native.convertRgbToJpeg(frameData.buffer, frameData.width, frameData.height, this.imageOptions(frameData));
+  }
+
+  // Whether a frame alerts is all that matters, the native scan ends once enough samples differ
+  private compareOptions(frameData: FrameData, scale: number): NativeCompareOptions {
+    return {
+      ...this.imageOptions(frameData),
+      stopAfter: Math.ceil(this.conf.pixels / (scale * scale)),
+      scanOrder: this.conf.scanOrder ?? 'interleaved',
+    };
+  }
+
+  private imageOptions(frameData: FrameData): NativeImageOptions {
+    return {channels: frameData.channels === 1 ? 1 : 3};
+  }
 }
@@ -0,0 +1,242 @@
+#include "camera_index.h"
+#include "logger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+
+namespace {
+    // Node changes that can add or remove a camera. IN_ATTRIB covers udev fixing permissions after creation
+    constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+
+    std::string Trim(const std::string& value) {
+        const auto begin = std::find_if_not(value.begin(), value.end(), [](unsigned char ch) { return std::isspace(ch); });
+        if (begin == value.end()) {
+            return "";
+        }
+        const auto end = std::find_if_not(value.rbegin(), value.rend(), [](unsigned char ch) { return std::isspace(ch); }).base();
+        return std::string(begin, end);
+    }
+
+    std::string ToLower(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return std::tolower(ch); });
+        return value;
+    }
+
+    std::string MakeUniqueCameraName(const std::map<std::string, std::string>& cameras, const std::string& baseName) {
+        std::string sanitized = Trim(baseName);
+        if (sanitized.empty()) {
+            sanitized = "Unknown Video Device";
+        }
+
+        if (cameras.find(sanitized) == cameras.end()) {
+            return sanitized;
+        }
+
+        int suffix = 2;
+        std::string candidate;
+        do {
+            candidate = sanitized + " (" + std::to_string(suffix++) + ")";
+        } while (cameras.find(candidate) != cameras.end());
+
+        return candidate;
+    }
+
+    // Only devices that support video capture and advertise at least one format
+    bool IsCaptureDevice(const std::string& devicePath) {
+        int fd = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd < 0) {
+            return false;
+        }
+        v4l2_capability cap = {};
+        v4l2_fmtdesc fmt = {};
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.index = 0;
+        bool capture = ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0 &&
+                       (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) &&
+                       ioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0;
+        close(fd);
+        return capture;
+    }
+
+    std::map<std::string, std::string> EnumerateCameras() {
+        std::map<std::string, std::string> cameras;
+
+        auto addCamera = [&](const std::string& name, const std::string& path) {
+            std::string devicePath = Trim(path);
+            if (devicePath.empty()) {
+                return;
+            }
+            std::string uniqueName = MakeUniqueCameraName(cameras, name.empty() ? devicePath : name);
+            cameras[uniqueName] = devicePath;
+        };
+
+        // Enumerate /sys/class/video4linux to discover video devices
+        DIR* dir = opendir("/sys/class/video4linux");
+        if (dir != nullptr) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                std::string node(entry->d_name);
+                if (node.rfind("video", 0) != 0) {
+                    continue;
+                }
+
+                std::string devicePath = "/dev/" + node;
+                if (access(devicePath.c_str(), F_OK) != 0 || !IsCaptureDevice(devicePath)) {
+                    continue;
+                }
+
+                std::ifstream nameFile("/sys/class/video4linux/" + node + "/name");
+                std::string cameraName;
+                if (nameFile.good()) {
+                    std::getline(nameFile, cameraName);
+                    cameraName = Trim(cameraName);
+                }
+                addCamera(cameraName.empty() ? devicePath : cameraName, devicePath);
+            }
+            closedir(dir);
+
+            if (!cameras.empty()) {
+                return cameras;
+            }
+        } else {
+            LOG_LNX_ERR("Failed to open /sys/class/video4linux for enumeration");
+        }
+
+        // Final fallback: probe /dev/video[0-63] with capability checking
+        for (int index = 0; index < 64; ++index) {
+            std::string devicePath = "/dev/video" + std::to_string(index);
+            if (access(devicePath.c_str(), F_OK) == 0 && IsCaptureDevice(devicePath)) {
+                addCamera("Video Device " + std::to_string(index), devicePath);
+            }
+        }
+
+        return cameras;
+    }
+}
+
+CameraIndex& CameraIndex::Instance() {
+    static CameraIndex* index = new CameraIndex();
+    return *index;
+}
+
+CameraIndex::CameraIndex() {
+    // Watches go in before the first enumeration, so a node changing while we enumerate marks the index stale
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        LOG_LNX_ERR("inotify unavailable, cameras are enumerated on every lookup: " << strerror(errno));
+        return;
+    }
+    // /dev is where nodes come and go, sysfs only reports changes on some kernels
+    if (inotify_add_watch(inotifyFd_, "/dev", kWatchMask) < 0) {
+        LOG_LNX_ERR("Failed to watch /dev, cameras are enumerated on every lookup: " << strerror(errno));
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return;
+    }
+    if (inotify_add_watch(inotifyFd_, "/sys/class/video4linux", kWatchMask) < 0 && errno != ENOENT) {
+        LOG_LNX_ERR("Failed to watch /sys/class/video4linux: " << strerror(errno));
+    }
+}
+
+void CameraIndex::DrainEvents() {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(inotifyFd_, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return;
+        }
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            auto* event = reinterpret_cast<inotify_event*>(cursor);
+            // Dropped events or a removed watch can hide anything, otherwise only video nodes matter
+            if ((event->mask & (IN_Q_OVERFLOW | IN_IGNORED)) != 0 ||
+                (event->len > 0 && strncmp(event->name, "video", 5) == 0)) {
+                stale_ = true;
+            }
+            cursor += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+void CameraIndex::Refresh() {
+    if (inotifyFd_ >= 0) {
+        DrainEvents();
+        if (!stale_) {
+            return;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    stale_ = false;
+    cameras_ = EnumerateCameras();
+    pathByName_.clear();
+    pathByLowerName_.clear();
+    paths_.clear();
+    formats_.clear();
+    for (const auto& camera : cameras_) {
+        pathByName_.emplace(camera.first, camera.second);
+        // First in name order wins when two names only differ in case
+        pathByLowerName_.emplace(ToLower(camera.first), camera.second);
+        paths_.insert(camera.second);
+    }
+
+    if (inotifyFd_ >= 0) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        LOG_LNX("Indexed " << cameras_.size() << " cameras in " << ms << "ms");
+    }
+}
+
+std::map<std::string, std::string> CameraIndex::GetCameras() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Refresh();
+    return cameras_;
+}
+
+std::string CameraIndex::FindPath(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Refresh();
+    auto exact = pathByName_.find(name);
+    if (exact != pathByName_.end()) {
+        return exact->second;
+    }
+    auto folded = pathByLowerName_.find(ToLower(name));
+    if (folded != pathByLowerName_.end()) {
+        return folded->second;
+    }
+    return paths_.count(name) != 0 ? name : std::string();
+}
+
+CaptureFormatSelection CameraIndex::ProbeFormat(const std::string& path, const CaptureFormatRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Refresh();
+    auto cached = formats_.find(path);
+    // Stepwise sizes were expanded for the request size, fps only matters to the selection
+    if (cached == formats_.end() || cached->second.minWidth != request.minWidth ||
+        cached->second.minHeight != request.minHeight) {
+        DeviceFormats formats = ProbeDeviceFormats(path, request);
+        // A busy or vanished device is tried again next time
+        if (!formats.error.empty() || paths_.count(path) == 0) {
+            return ResolveCaptureFormat(formats, request);
+        }
+        cached = formats_.insert_or_assign(path, std::move(formats)).first;
+    }
+    return ResolveCaptureFormat(cached->second, request);
+}
+
+void CameraIndex::ForgetFormats(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    formats_.erase(path);
+}
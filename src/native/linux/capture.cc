@@ -1,9 +1,17 @@
 #include "capture.h"
 #include "common.h"
+#include "frame_pool.h"
+#include "frame_mailbox.h"
+#include "capture_format.h"
+#include "converter_registry.h"
+#include "camera_index.h"
+#include "addon_data.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <linux/videodev2.h>
 #include <string.h>
 #include <errno.h>
@@ -16,11 +24,14 @@
 #include <sstream>
 #include <map>
 #include <algorithm>
-#include <array>
 #include <vector>
 #include <setjmp.h>
 #include <stdexcept>
 #include <cctype>
+#include <time.h>
+#include <numeric>
+#include <limits>
+#include <set>
 
 #include <jpeglib.h>
 
@@ -31,18 +42,6 @@ namespace {
         return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
     }
 
-    inline std::array<uint8_t, 3> YuvToRgb(uint8_t y, uint8_t u, uint8_t v) {
-        int c = static_cast<int>(y) - 16;
-        int d = static_cast<int>(u) - 128;
-        int e = static_cast<int>(v) - 128;
-
-        int r = (298 * c + 409 * e + 128) >> 8;
-        int g = (298 * c - 100 * d - 208 * e + 128) >> 8;
-        int b = (298 * c + 516 * d + 128) >> 8;
-
-        return {ClampToByte(r), ClampToByte(g), ClampToByte(b)};
-    }
-
     struct JpegErrorManager {
         jpeg_error_mgr pub;
         jmp_buf setjmpBuffer;
@@ -53,6 +52,81 @@ namespace {
         (*cinfo->err->output_message)(cinfo);
         longjmp(err->setjmpBuffer, 1);
     }
+
+    // Fills dst with the mean of every 8x8 luma block, read from the quantised DC coefficients.
+    // Only the entropy decode runs, no IDCT, upsampling or colour conversion
+    bool DecodeDcPlane(const uint8_t* jpegData, size_t jpegSize, uint8_t* dst, int outWidth, int outHeight) {
+        JpegErrorManager jerr;
+        jpeg_decompress_struct cinfo;
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = JpegErrorExit;
+
+        if (setjmp(jerr.setjmpBuffer)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, const_cast<unsigned char*>(jpegData), static_cast<unsigned long>(jpegSize));
+        if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jvirt_barray_ptr* coefficients = jpeg_read_coefficients(&cinfo);
+        jpeg_component_info* luma = &cinfo.comp_info[0];
+        const int quantDc = luma->quant_table != nullptr ? luma->quant_table->quantval[0] : 1;
+        const int rows = std::min(outHeight, static_cast<int>(luma->height_in_blocks));
+        const int cols = std::min(outWidth, static_cast<int>(luma->width_in_blocks));
+        if (rows == 0 || cols == 0) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        for (int row = 0; row < outHeight; ++row) {
+            uint8_t* out = dst + static_cast<size_t>(row) * outWidth;
+            if (row >= rows) {
+                memcpy(out, out - outWidth, outWidth);
+                continue;
+            }
+            JBLOCKARRAY blocks = (*cinfo.mem->access_virt_barray)(
+                reinterpret_cast<j_common_ptr>(&cinfo), coefficients[0], static_cast<JDIMENSION>(row), 1, FALSE);
+            for (int col = 0; col < cols; ++col) {
+                // The forward DCT scales DC to 8 * (mean - 128)
+                out[col] = ClampToByte(blocks[0][col][0] * quantDc / 8 + 128);
+            }
+            for (int col = cols; col < outWidth; ++col) {
+                out[col] = out[cols - 1];
+            }
+        }
+
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    int64_t MonotonicNowUs() {
+        timespec now = {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+    }
+
+    bool HasMonotonicTimestamp(const v4l2_buffer& buf) {
+        return (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    }
+
+    // Capture time of a dequeued buffer on CLOCK_MONOTONIC, falls back to "now" for drivers without monotonic stamps
+    int64_t BufferTimestampUs(const v4l2_buffer& buf) {
+        if (!HasMonotonicTimestamp(buf)) {
+            return MonotonicNowUs();
+        }
+        return static_cast<int64_t>(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+    }
+
+    // Buffers the driver flags as corrupt or returns empty, sensors often emit one while reconfiguring
+    bool IsCorruptBuffer(const v4l2_buffer& buf) {
+        return (buf.flags & V4L2_BUF_FLAG_ERROR) != 0 || buf.bytesused == 0;
+    }
 }
 
 using namespace std;
@@ -65,10 +139,12 @@ struct buffer {
 
 void LinuxCapture::SetEnv(Napi::Env env) {
     env_ = env;
+    envThreadId_ = std::this_thread::get_id();
 }
 
 [[noreturn]] void LinuxCapture::ThrowError(const std::string& message) const {
-    if (env_ != nullptr) {
+    // Napi errors can only be created on the JS thread, the capture thread gets plain exceptions
+    if (env_ != nullptr && std::this_thread::get_id() == envThreadId_) {
         throw Napi::Error::New(Napi::Env(env_), message);
     }
     throw std::runtime_error(message);
@@ -94,171 +170,152 @@ LinuxCapture::~LinuxCapture() {
         LOG_LNX_ERR("StopCapture raised error during destruction: " << err.what());
     }
 
+    // A failed reconnect leaves buffers behind without capturing
+    UninitDevice();
+    CloseWaitSet();
+    CloseDevice();
+}
+
+void LinuxCapture::SetupWaitSet() {
+    // The epoll set and the wake eventfd outlive reconnects, so Wake() from another thread never sees them change
+    if (epollFd_ < 0) {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0) {
+            ThrowSystemError("epoll_create1 failed", errno);
+        }
+
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd_ < 0) {
+            int err = errno;
+            CloseWaitSet();
+            ThrowSystemError("eventfd failed", err);
+        }
+
+        epoll_event wakeEvent = {};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = wakeFd_;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) == -1) {
+            int err = errno;
+            CloseWaitSet();
+            ThrowSystemError("epoll_ctl failed", err);
+        }
+    }
+
+    epoll_event deviceEvent = {};
+    deviceEvent.events = EPOLLIN;
+    deviceEvent.data.fd = fd_;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd_, &deviceEvent) == -1) {
+        ThrowSystemError("epoll_ctl failed", errno);
+    }
+}
+
+void LinuxCapture::CloseDevice() {
     if (fd_ >= 0) {
+        // Closing drops the fd from the epoll set as well
         close(fd_);
         fd_ = -1;
     }
 }
 
-// Helper function to get a map of available camera names to device paths
-static string Trim(const string& value) {
-    const auto begin = find_if_not(value.begin(), value.end(), [](unsigned char ch) { return std::isspace(ch); });
-    if (begin == value.end()) {
-        return "";
+void LinuxCapture::Reconnect() {
+    // Whatever is left of the old handle goes, a vanished device fails most of these calls
+    isCapturing_ = false;
+    if (fd_ >= 0) {
+        try {
+            StopStreaming();
+        } catch (const std::exception& err) {
+            LOG_LNX_ERR("Ignoring error stopping lost device: " << err.what());
+        }
     }
-    const auto end = find_if_not(value.rbegin(), value.rend(), [](unsigned char ch) { return std::isspace(ch); }).base();
-    return string(begin, end);
-}
+    UninitDevice();
+    CloseDevice();
 
-static string MakeUniqueCameraName(map<string, string>& cameras, const string& baseName) {
-    string sanitized = Trim(baseName);
-    if (sanitized.empty()) {
-        sanitized = "Unknown Video Device";
+    // Same camera only, it may come back under another /dev/video node. Never the partial match, direct path
+    // or first camera fallbacks of OpenDevice(), the old node may now belong to something else
+    const string devicePath = FindSameDevice();
+    if (devicePath.empty()) {
+        ThrowError("Device " + requestedDevice_ + " is not present");
     }
 
-    if (cameras.find(sanitized) == cameras.end()) {
-        return sanitized;
+    // Not StartCapture(): pacing and frame accounting carry on across the gap
+    LOG_LNX("Reopening " << requestedDevice_ << " at " << devicePath);
+    OpenPath(devicePath);
+    {
+        std::lock_guard<std::mutex> lock(identityMutex_);
+        deviceName_ = devicePath;
     }
-
-    int suffix = 2;
-    string candidate;
-    do {
-        candidate = sanitized + " (" + to_string(suffix++) + ")";
-    } while (cameras.find(candidate) != cameras.end());
-
-    return candidate;
+    InitDevice(fps_);
+    StartStreaming();
+    isCapturing_ = true;
 }
 
-static map<string, string> GetAvailableCameras() {
-    map<string, string> cameras;
+string LinuxCapture::FindSameDevice() const {
+    // The exact or case-insensitive name start() resolved
+    string devicePath = CameraIndex::Instance().FindPath(requestedDevice_);
+    if (!devicePath.empty() || busInfo_.empty()) {
+        return devicePath;
+    }
 
-    auto addCamera = [&](const string& name, const string& path) {
-        if (path.empty()) {
-            return;
+    // Partial names and direct paths: the indexed capture node on the same bus position
+    for (const auto& cam : CameraIndex::Instance().GetCameras()) {
+        int testFd = open(cam.second.c_str(), O_RDWR | O_NONBLOCK);
+        if (testFd < 0) {
+            continue;
         }
-        string devicePath = Trim(path);
-        if (devicePath.empty()) {
-            return;
+        v4l2_capability cap = {};
+        const bool sameBus = ioctl(testFd, VIDIOC_QUERYCAP, &cap) == 0 &&
+            busInfo_ == reinterpret_cast<const char*>(cap.bus_info);
+        close(testFd);
+        if (sameBus) {
+            return cam.second;
         }
-        string uniqueName = MakeUniqueCameraName(cameras, name.empty() ? devicePath : name);
-        cameras[uniqueName] = devicePath;
-    };
-
-    // Use native system calls instead of external v4l2-ctl command
-
-    // Enumerate /sys/class/video4linux to discover video devices
-    DIR* dir = opendir("/sys/class/video4linux");
-    if (dir != nullptr) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            if (entry->d_name[0] == '.') {
-                continue;
-            }
-
-            string node(entry->d_name);
-            if (node.rfind("video", 0) != 0) {
-                continue;
-            }
-
-            string devicePath = string("/dev/") + node;
-            if (access(devicePath.c_str(), F_OK) != 0) {
-                continue;
-            }
+    }
+    return "";
+}
 
-            // Check if this device supports video capture and has formats before adding it
-            int fd = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
-            if (fd >= 0) {
-                v4l2_capability cap = {};
-                if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
-                    // Only add devices that support video capture
-                    if (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) {
-                        // Also check if the device supports any video formats
-                        v4l2_fmtdesc fmt = {};
-                        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-                        fmt.index = 0;
-                        
-                        if (ioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0) {
-                            // Device has at least one supported format
-                            string namePath = string("/sys/class/video4linux/") + node + "/name";
-                            ifstream nameFile(namePath);
-                            string cameraName;
-                            if (nameFile.good()) {
-                                getline(nameFile, cameraName);
-                                cameraName = Trim(cameraName);
-                            }
-
-                            addCamera(cameraName.empty() ? devicePath : cameraName, devicePath);
-                        }
-                    }
-                }
-                close(fd);
-            }
-        }
-        closedir(dir);
+void LinuxCapture::CloseWaitSet() {
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+    }
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+        epollFd_ = -1;
+    }
+}
 
-        if (!cameras.empty()) {
-            return cameras;
-        }
-    } else {
-        LOG_LNX_ERR("Failed to open /sys/class/video4linux for enumeration");
-    }
-
-    // Final fallback: probe /dev/video[0-63] with capability checking
-    for (int index = 0; index < 64; ++index) {
-        string devicePath = string("/dev/video") + to_string(index);
-        if (access(devicePath.c_str(), F_OK) == 0) {
-            // Check if this device supports video capture and has formats
-            int fd = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
-            if (fd >= 0) {
-                v4l2_capability cap = {};
-                if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
-                    // Only add devices that support video capture
-                    if (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) {
-                        // Also check if the device supports any video formats
-                        v4l2_fmtdesc fmt = {};
-                        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-                        fmt.index = 0;
-                        
-                        if (ioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0) {
-                            // Device has at least one supported format
-                            addCamera("Video Device " + to_string(index), devicePath);
-                        }
-                    }
-                }
-                close(fd);
-            }
+void LinuxCapture::Wake() {
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+            LOG_LNX_ERR("Failed to signal capture wakeup: " << strerror(errno));
         }
     }
-
-    return cameras;
 }
 
 void LinuxCapture::OpenDevice(const string& deviceName) {
-    // First, get all available cameras
-    auto cameras = GetAvailableCameras();
-
-    // Debug: Print all available cameras
-    LOG_LNX("Available cameras:");
-    for (const auto& cam : cameras) {
-        LOG_LNX("  " << cam.first << " -> " << cam.second);
+    if (requestedDevice_.empty()) {
+        requestedDevice_ = deviceName;
     }
+    // Exact and case-insensitive names resolve from the cached index without touching any device
+    string devicePath = CameraIndex::Instance().FindPath(deviceName);
+    map<string, string> cameras;
 
-    string devicePath;
+    if (devicePath.empty()) {
+        cameras = CameraIndex::Instance().GetCameras();
 
-    // Try to find the requested camera by name
-    auto it = cameras.find(deviceName);
-    if (it != cameras.end()) {
-        // Found by exact name
-        devicePath = it->second;
-    } else {
-        // Try case-insensitive search
+        // Debug: Print all available cameras
+        LOG_LNX("Available cameras:");
         for (const auto& cam : cameras) {
-            string lowerCamName = cam.first;
-            string lowerDeviceName = deviceName;
+            LOG_LNX("  " << cam.first << " -> " << cam.second);
+        }
 
-            // Convert to lowercase for case-insensitive comparison
+        // Try a partial case-insensitive match
+        string lowerDeviceName = deviceName;
+        transform(lowerDeviceName.begin(), lowerDeviceName.end(), lowerDeviceName.begin(), ::tolower);
+        for (const auto& cam : cameras) {
+            string lowerCamName = cam.first;
             transform(lowerCamName.begin(), lowerCamName.end(), lowerCamName.begin(), ::tolower);
-            transform(lowerDeviceName.begin(), lowerDeviceName.end(), lowerDeviceName.begin(), ::tolower);
 
             if (lowerCamName.find(lowerDeviceName) != string::npos) {
                 devicePath = cam.second;
@@ -304,7 +361,17 @@ void LinuxCapture::OpenDevice(const string& deviceName) {
     }
 
     LOG_LNX("Using device path: " << devicePath);
-    deviceName_ = devicePath;  // Store the actual device path
+    {
+        std::lock_guard<std::mutex> lock(identityMutex_);
+        deviceName_ = devicePath;  // Store the actual device path
+    }
+
+    busInfo_ = OpenPath(devicePath);
+}
+
+string LinuxCapture::OpenPath(const string& devicePath) {
+    // Capturing sets the driver format, a cached default would be out of date
+    CameraIndex::Instance().ForgetFormats(devicePath);
 
     // Try to open the device
     fd_ = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
@@ -336,9 +403,38 @@ void LinuxCapture::OpenDevice(const string& deviceName) {
         fd_ = -1;
         ThrowError("Device does not support video capture");
     }
+
+    try {
+        SetupWaitSet();
+    } catch (...) {
+        close(fd_);
+        fd_ = -1;
+        throw;
+    }
+    return reinterpret_cast<const char*>(cap.bus_info);
+}
+
+void LinuxCapture::SetOptions(const CaptureOptions& options) {
+    options_ = options;
+    converter_ = std::make_unique<ParallelConverter>(options.conversionThreads);
+    rawLoans_ = std::make_shared<std::atomic<int>>(options.rawFrames);
+}
+
+string LinuxCapture::GetDeviceName() const {
+    std::lock_guard<std::mutex> lock(identityMutex_);
+    return deviceName_;
 }
 
-void LinuxCapture::StartCapture(int fps) {
+CaptureFormatSelection LinuxCapture::GetFormatSelection() const {
+    std::lock_guard<std::mutex> lock(identityMutex_);
+    return formatSelection_;
+}
+
+ParallelConvertStats LinuxCapture::GetConversionStats() const {
+    return converter_ ? converter_->GetStats() : ParallelConvertStats();
+}
+
+void LinuxCapture::StartCapture(double fps) {
     LOG_LNX("Starting capture (will use camera's preferred resolution) at " << fps << "fps");
 
     if (isCapturing_) {
@@ -347,6 +443,8 @@ void LinuxCapture::StartCapture(int fps) {
     }
 
     fps_ = fps;
+    pacer_.Reset(fps);
+    sequence_.Reset();
     // width_ and height_ will be set by InitDevice based on camera's actual format
 
     InitDevice(fps);
@@ -367,10 +465,18 @@ void LinuxCapture::StopCapture() {
     UninitDevice();
 }
 
-void LinuxCapture::InitDevice(int fps) {
-    LOG_LNX("Initializing device (using camera's preferred format and resolution)");
+void LinuxCapture::InitDevice(double fps) {
+    CaptureFormatRequest request;
+    request.minWidth = options_.minWidth;
+    request.minHeight = options_.minHeight;
+    request.fps = fps;
+    CaptureFormatSelection selection = ResolveCaptureFormat(fd_, request);
+    {
+        std::lock_guard<std::mutex> lock(identityMutex_);
+        formatSelection_ = std::move(selection);
+    }
+    LOG_LNX("Capture mode: " << formatSelection_.reason);
 
-    // Get the camera's current/default format without trying to change it
     v4l2_format fmt = {};
     fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
@@ -382,37 +488,86 @@ void LinuxCapture::InitDevice(int fps) {
         ThrowSystemError("Failed to get current format from device " + deviceName_, err);
     }
 
-    LOG_LNX("Camera's default format: "
-            << (char)(fmt.fmt.pix.pixelformat & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 8) & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 16) & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 24) & 0xFF)
-            << " (" << fmt.fmt.pix.width << "x" << fmt.fmt.pix.height << ")");
+    pixelFormat_ = fmt.fmt.pix.pixelformat;
+    width_ = static_cast<int>(fmt.fmt.pix.width);
+    height_ = static_cast<int>(fmt.fmt.pix.height);
+
+    if (!formatSelection_.negotiated && !IsSupportedPixelFormat(pixelFormat_)) {
+        ThrowError("Device " + deviceName_ + " offers no supported pixel format, current one is " +
+                   FourccToString(pixelFormat_));
+    }
+
+    hasSnapshotMode_ = false;
+    if (formatSelection_.negotiated) {
+        SetFormat(formatSelection_.mode);
+
+        // Detection runs below full resolution, remember the mode snapshots switch to
+        CaptureFormatSelection full = SelectFullResolutionFormat(EnumerateCaptureModes(fd_, request));
+        if (full.negotiated &&
+            static_cast<int64_t>(full.mode.width) * full.mode.height > static_cast<int64_t>(width_) * height_) {
+            snapshotMode_ = full.mode;
+            hasSnapshotMode_ = true;
+            LOG_LNX("Snapshot mode: " << full.reason);
+        }
+    }
+
+    LOG_LNX("Using format: " << FourccToString(pixelFormat_) << " (" << width_ << "x" << height_ << ")"
+            << ", " << GetConvertKernels().name << " conversion kernels on "
+            << GetConversionStats().threads << " thread(s)");
+
+    const bool isMjpeg = pixelFormat_ == V4L2_PIX_FMT_MJPEG;
+    reducedDecode_ = options_.decodeScale > 1 || options_.grayscale || (isMjpeg && options_.dctDetection);
+    if (!isMjpeg && reducedDecode_) {
+        LOG_LNX("Converting detection frames at 1/" << options_.decodeScale
+                << (options_.grayscale ? " to luma" : " to RGB") << ", RGB is only produced in full for snapshots");
+    } else if (reducedDecode_ && options_.dctDetection) {
+        LOG_LNX("Detecting on MJPEG DC coefficients, one sample per 8x8 block");
+    } else if (reducedDecode_) {
+        LOG_LNX("Decoding detection frames at 1/" << options_.decodeScale
+                << (options_.grayscale ? " to grayscale" : " to RGB"));
+    }
+
+    SetFrameRate(fps);
 
-    // Use the camera's default format and resolution - no changes needed
-    LOG_LNX("Using camera's default format and resolution");
+    // Request buffers
+    LOG_LNX("Requesting video buffers...");
+    RequestBuffers();
+}
 
-    // Check what format we actually got
-    LOG_LNX("Set format to: "
-            << (char)(fmt.fmt.pix.pixelformat & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 8) & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 16) & 0xFF)
-            << (char)((fmt.fmt.pix.pixelformat >> 24) & 0xFF)
-            << " (" << fmt.fmt.pix.width << "x" << fmt.fmt.pix.height << ")");
+void LinuxCapture::SetFormat(const CaptureMode& mode) {
+    v4l2_format fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.pixelformat = mode.pixelFormat;
+    fmt.fmt.pix.width = static_cast<uint32_t>(mode.width);
+    fmt.fmt.pix.height = static_cast<uint32_t>(mode.height);
+    fmt.fmt.pix.field = V4L2_FIELD_ANY;
+    if (xioctl(fd_, VIDIOC_S_FMT, &fmt) == -1) {
+        ThrowSystemError("Failed to set format on device " + deviceName_, errno);
+    }
 
+    // The driver may adjust S_FMT, so take whatever it reports back
     pixelFormat_ = fmt.fmt.pix.pixelformat;
-    
-    // Update dimensions to actual values returned by the camera
     width_ = static_cast<int>(fmt.fmt.pix.width);
     height_ = static_cast<int>(fmt.fmt.pix.height);
-    
-    LOG_LNX("Updated dimensions to actual camera format: " << width_ << "x" << height_);
+}
 
-    // Set frame rate
+void LinuxCapture::SetFrameRate(double fps) {
+    // Set frame rate, expressed as a rational so fractional rates like 0.5fps survive
     v4l2_streamparm parm = {};
     parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    parm.parm.capture.timeperframe.numerator = 1;
-    parm.parm.capture.timeperframe.denominator = fps;
+    if (formatSelection_.negotiated && formatSelection_.mode.intervalDenominator > 0) {
+        // The selected interval is the slowest one reaching fps, the pacer drops the rest
+        parm.parm.capture.timeperframe.numerator = formatSelection_.mode.intervalNumerator;
+        parm.parm.capture.timeperframe.denominator = formatSelection_.mode.intervalDenominator;
+    } else {
+        uint32_t numerator = 1000;
+        // Rates below 0.0005fps would round to a zero denominator, the slowest we ask for is one frame in 1000s
+        uint32_t denominator = static_cast<uint32_t>(
+            std::clamp(std::lround(fps * 1000.0), 1L, static_cast<long>(std::numeric_limits<uint32_t>::max())));
+        uint32_t divisor = std::gcd(numerator, denominator);
+        parm.parm.capture.timeperframe.numerator = numerator / divisor;
+        parm.parm.capture.timeperframe.denominator = denominator / divisor;
+    }
 
     LOG_LNX("Setting frame rate to " << fps << "fps");
     if (xioctl(fd_, VIDIOC_S_PARM, &parm) == -1) {
@@ -436,18 +591,49 @@ void LinuxCapture::InitDevice(int fps) {
             LOG_LNX_ERR("Failed to verify framerate: " << strerror(errno));
         }
     }
+}
 
-    // Request buffers
-    LOG_LNX("Requesting video buffers...");
+void LinuxCapture::SwitchMode(const CaptureMode& mode, bool restoreFrameRate) {
+    // Buffers are sized for the old format, so the whole queue is rebuilt around S_FMT
+    StopStreaming();
+    UninitDevice();
+
+    // Drivers refuse S_FMT with EBUSY while buffers are still allocated
+    v4l2_requestbuffers req = {};
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = BufferMemory();
+    if (xioctl(fd_, VIDIOC_REQBUFS, &req) == -1) {
+        ThrowSystemError("Failed to release buffers before switching format", errno);
+    }
+
+    SetFormat(mode);
+    if (restoreFrameRate) {
+        SetFrameRate(fps_);
+    }
     RequestBuffers();
+    StartStreaming();
 }
 
 void LinuxCapture::UninitDevice() {
     LOG_LNX("Uninitializing device, releasing " << buffers_.size() << " buffers");
 
+    if (userPtr_ && !ringFrames_.empty() && fd_ >= 0) {
+        // The driver lets go of our pages only once its buffers are freed
+        v4l2_requestbuffers req = {};
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_USERPTR;
+        if (xioctl(fd_, VIDIOC_REQBUFS, &req) == -1) {
+            LOG_LNX_ERR("Failed to free USERPTR buffers: " << strerror(errno));
+        }
+    }
+    for (FrameData* frame : ringFrames_) {
+        FramePool::Instance().Release(frame);
+    }
+    ringFrames_.clear();
+
     for (size_t i = 0; i < buffers_.size(); ++i) {
         if (buffers_[i]) {
-            if (buffers_[i]->start && buffers_[i]->length > 0) {
+            if (!userPtr_ && buffers_[i]->start && buffers_[i]->length > 0) {
                 if (munmap(buffers_[i]->start, buffers_[i]->length) == -1) {
                     int err = errno;
                     LOG_LNX_ERR("Failed to munmap buffer " << i << ": (" << err << ") " << strerror(err));
@@ -462,10 +648,48 @@ void LinuxCapture::UninitDevice() {
     buffers_.clear();
 }
 
+uint32_t LinuxCapture::BufferMemory() const {
+    return userPtr_ ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
+}
+
+bool LinuxCapture::RequestUserPtrBuffers() {
+    v4l2_requestbuffers req = {};
+    req.count = static_cast<uint32_t>(options_.bufferCount);
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_USERPTR;
+    if (xioctl(fd_, VIDIOC_REQBUFS, &req) == -1 || req.count == 0) {
+        LOG_LNX("Driver refuses USERPTR buffers (" << strerror(errno) << "), using MMAP");
+        return false;
+    }
+
+    v4l2_format fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd_, VIDIOC_G_FMT, &fmt) == -1 || fmt.fmt.pix.sizeimage == 0) {
+        LOG_LNX("Driver reports no frame size for USERPTR buffers, using MMAP");
+        req.count = 0;
+        xioctl(fd_, VIDIOC_REQBUFS, &req);
+        return false;
+    }
+
+    userPtr_ = true;
+    ringFrameSize_ = fmt.fmt.pix.sizeimage;
+    for (unsigned int i = 0; i < req.count; ++i) {
+        FrameData* frame = FramePool::Instance().Acquire(width_, height_, pixelFormat_, ringFrameSize_, true);
+        ringFrames_.push_back(frame);
+        buffers_.push_back(new buffer{frame->data, ringFrameSize_});
+    }
+    LOG_LNX("Driver accepted " << req.count << " USERPTR buffers of " << ringFrameSize_ << " bytes from the frame pool");
+    return true;
+}
+
 void LinuxCapture::RequestBuffers() {
-    // Request 4 buffers
+    userPtr_ = false;
+    if (options_.userPtr && RequestUserPtrBuffers()) {
+        return;
+    }
+
     v4l2_requestbuffers req = {};
-    req.count = 4;
+    req.count = static_cast<uint32_t>(options_.bufferCount);
     req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
 
@@ -480,7 +704,7 @@ void LinuxCapture::RequestBuffers() {
         ThrowError("VIDIOC_REQBUFS returned zero buffers");
     }
 
-    LOG_LNX("Driver allocated " << req.count << " buffers");
+    LOG_LNX("Driver allocated " << req.count << " buffers (requested " << options_.bufferCount << ")");
 
     // Map the buffers
     for (unsigned int i = 0; i < req.count; ++i) {
@@ -523,8 +747,12 @@ void LinuxCapture::StartStreaming() {
     for (size_t i = 0; i < buffers_.size(); ++i) {
         v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
+        buf.memory = BufferMemory();
         buf.index = i;
+        if (userPtr_) {
+            buf.m.userptr = reinterpret_cast<unsigned long>(buffers_[i]->start);
+            buf.length = static_cast<uint32_t>(buffers_[i]->length);
+        }
 
         LOG_LNX("Queueing buffer " << i << "...");
         QueueBuffer(buf);
@@ -533,6 +761,8 @@ void LinuxCapture::StartStreaming() {
 
     // Start streaming
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    sequence_.Restart();
+    lastBufferUs_ = MonotonicNowUs();
     LOG_LNX("Starting video capture...");
     if (xioctl(fd_, VIDIOC_STREAMON, &type) == -1) {
         int err = errno;
@@ -576,76 +806,241 @@ void LinuxCapture::DequeueBuffer(v4l2_buffer& buf) {
         LOG_LNX_ERR("VIDIOC_DQBUF failed: (" << err << ") " << strerror(err));
         ThrowSystemError("VIDIOC_DQBUF failed", err);
     }
+    sequence_.Observe(buf.sequence);
+    lastBufferUs_ = MonotonicNowUs();
 //     LOG_LNX("Dequeued buffer " << buf.index << " with " << buf.bytesused << " bytes used");
 }
 
-FrameData* LinuxCapture::GetFrame() {
-    if (!isCapturing_) {
-        return nullptr;
-    }
-
-//     LOG_LNX("Waiting for frame...");
+bool LinuxCapture::TryDequeueBuffer(v4l2_buffer& buf) {
+    // The device is opened with O_NONBLOCK, so EAGAIN means the driver has nothing filled yet
+    int ret;
+    do {
+        ret = ioctl(fd_, VIDIOC_DQBUF, &buf);
+    } while (ret == -1 && errno == EINTR);
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(fd_, &fds);
+    if (ret == -1) {
+        int err = errno;
+        if (err == EAGAIN) {
+            return false;
+        }
+        LOG_LNX_ERR("VIDIOC_DQBUF failed while draining: (" << err << ") " << strerror(err));
+        ThrowSystemError("VIDIOC_DQBUF failed", err);
+    }
+    sequence_.Observe(buf.sequence);
+    lastBufferUs_ = MonotonicNowUs();
+    return true;
+}
 
-    struct timeval tv;
-    tv.tv_sec = 2;
-    tv.tv_usec = 0;
-    tv.tv_sec = 2; // 2 second timeout
+void LinuxCapture::DrainToLatest(v4l2_buffer& buf) {
+    // Hand every older filled buffer straight back to the driver so we only convert the newest frame
+    while (true) {
+        v4l2_buffer next = {};
+        next.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        next.memory = BufferMemory();
+        if (!TryDequeueBuffer(next)) {
+            break;
+        }
+        QueueBuffer(buf);
+        sequence_.CountSkipped();
+        buf = next;
+    }
+}
 
-    int r = select(fd_ + 1, &fds, NULL, NULL, &tv);
+LinuxCapture::WaitResult LinuxCapture::WaitForBuffer(v4l2_buffer& buf) {
+    // Wait for the driver or for Wake(), the timeout only exists to report stalled cameras
+    epoll_event events[2];
+    int r = epoll_wait(epollFd_, events, 2, options_.stallTimeoutMs);
     if (r == -1) {
         int err = errno;
-        LOG_LNX_ERR("select() failed while waiting for frame: (" << err << ") " << strerror(err));
-        return nullptr;
+        if (err == EINTR) {
+            return WaitResult::Timeout;
+        }
+        LOG_LNX_ERR("epoll_wait() failed while waiting for frame: (" << err << ") " << strerror(err));
+        ThrowSystemError("epoll_wait() failed while waiting for frame", err);
     }
 
     if (r == 0) {
-        LOG_LNX_ERR("select() timeout waiting for frame");
-        return nullptr; // Timeout
+        LOG_LNX_ERR("epoll_wait() timeout waiting for frame");
+        return WaitResult::Timeout;
     }
 
-    v4l2_buffer buf = {};
+    for (int i = 0; i < r; ++i) {
+        if (events[i].data.fd == wakeFd_) {
+            uint64_t counter = 0;
+            if (read(wakeFd_, &counter, sizeof(counter)) == -1 && errno != EAGAIN) {
+                LOG_LNX_ERR("Failed to reset capture wakeup: " << strerror(errno));
+            }
+            return WaitResult::Woken;
+        }
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            ThrowError("Device " + deviceName_ + " reported an error while waiting for frame");
+        }
+    }
+
+    buf = {};
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = BufferMemory();
 
     DequeueBuffer(buf);
+    return WaitResult::Frame;
+}
 
-    // Process the frame
-    FrameData* frame = new FrameData();
-    frame->width = width_;
-    frame->height = height_;
+FrameData* LinuxCapture::GetFrame() {
+    if (!isCapturing_) {
+        return nullptr;
+    }
 
-    if (pixelFormat_ == V4L2_PIX_FMT_YUYV) {
-        size_t expectedSize = static_cast<size_t>(width_) * static_cast<size_t>(height_) * 3;
-        frame->buffer.resize(expectedSize);
-        const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index]->start);
-        uint8_t* dst = frame->buffer.data();
-
-        for (int y = 0; y < height_; ++y) {
-            for (int x = 0; x < width_; x += 2) {
-                size_t yuyvIndex = (y * width_ + x) * 2;
-                uint8_t y0 = src[yuyvIndex + 0];
-                uint8_t u  = src[yuyvIndex + 1];
-                uint8_t y1 = src[yuyvIndex + 2];
-                uint8_t v  = src[yuyvIndex + 3];
-
-                auto rgb0 = YuvToRgb(y0, u, v);
-                auto rgb1 = YuvToRgb(y1, u, v);
-
-                size_t rgbIndex = (static_cast<size_t>(y) * width_ + x) * 3;
-                dst[rgbIndex + 0] = rgb0[0];
-                dst[rgbIndex + 1] = rgb0[1];
-                dst[rgbIndex + 2] = rgb0[2];
-                dst[rgbIndex + 3] = rgb1[0];
-                dst[rgbIndex + 4] = rgb1[1];
-                dst[rgbIndex + 5] = rgb1[2];
+    v4l2_buffer buf = {};
+    if (WaitForBuffer(buf) != WaitResult::Frame) {
+        return nullptr;
+    }
+    if (options_.latestFrameOnly) {
+        DrainToLatest(buf);
+    }
+    if (IsCorruptBuffer(buf)) {
+        QueueBuffer(buf);
+        sequence_.CountDiscarded();
+        return nullptr;
+    }
+
+    // Frames the pacer doesn't want go straight back to the driver without being converted
+    int64_t timestampUs = BufferTimestampUs(buf);
+    if (!pacer_.ShouldProcess(timestampUs)) {
+        QueueBuffer(buf);
+        sequence_.CountSkipped();
+        return nullptr;
+    }
+
+    FrameData* frame = ConvertBuffer(buf, false);
+    if (frame != nullptr) {
+        frame->lateMs = static_cast<double>(pacer_.LastLatenessUs()) / 1000.0;
+    }
+    return frame;
+}
+
+SnapshotResult LinuxCapture::CaptureSnapshot(const std::function<bool()>& stopRequested) {
+    if (!NeedsSnapshot()) {
+        ThrowError("Capture already delivers full resolution RGB frames");
+    }
+
+    // A reduced MJPEG decode alone only needs the next frame decoded in full, not a mode switch
+    const bool switchMode = hasSnapshotMode_;
+    const CaptureMode detectionMode = formatSelection_.mode;
+    SnapshotResult result;
+    std::string failure;
+    int64_t startUs = MonotonicNowUs();
+
+    try {
+        if (switchMode) {
+            SwitchMode(snapshotMode_, false);
+        }
+
+        // Skip corrupt frames. A wakeup is usually the snapshot request itself, left signalled because the
+        // thread was converting rather than waiting, only a stop ends the snapshot
+        for (int attempt = 0; attempt < 3 && result.frame == nullptr; ++attempt) {
+            v4l2_buffer buf = {};
+            WaitResult waited = WaitForBuffer(buf);
+            if (waited == WaitResult::Woken) {
+                if (stopRequested()) {
+                    ThrowError("Snapshot interrupted");
+                }
+                --attempt;
+                continue;
+            }
+            if (waited == WaitResult::Frame) {
+                if (IsCorruptBuffer(buf)) {
+                    QueueBuffer(buf);
+                    sequence_.CountDiscarded();
+                    continue;
+                }
+                result.frame = ConvertBuffer(buf, true);
             }
         }
+        if (result.frame == nullptr) {
+            ThrowError("No usable frame in " + FourccToString(pixelFormat_) + " " +
+                       std::to_string(width_) + "x" + std::to_string(height_));
+        }
+    } catch (const std::exception& err) {
+        failure = err.what();
+    }
+    int64_t capturedUs = MonotonicNowUs();
+
+    if (switchMode) {
+        try {
+            SwitchMode(detectionMode, true);
+        } catch (...) {
+            FramePool::Instance().Release(result.frame);
+            throw;
+        }
+    }
+    int64_t restoredUs = MonotonicNowUs();
+
+    if (!failure.empty()) {
+        ThrowError("Full resolution snapshot failed: " + failure);
+    }
+
+    result.switchMs = static_cast<double>(capturedUs - startUs) / 1000.0;
+    result.restoreMs = static_cast<double>(restoredUs - capturedUs) / 1000.0;
+    LOG_LNX("Snapshot " << result.frame->width << "x" << result.frame->height << " took "
+            << result.switchMs << "ms, restoring detection mode " << result.restoreMs << "ms");
+    return result;
+}
+
+FrameData* LinuxCapture::ConvertBuffer(v4l2_buffer& buf, bool fullDecode) {
+    int64_t timestampUs = BufferTimestampUs(buf);
+
+    // Detection frames may be downscaled and reduced to luma; MJPEG does both through libjpeg's DCT scaling
+    // or skips decoding pixels altogether with one DC sample per 8x8 block. Snapshots are always full RGB
+    const PixelConverter* converter = FindPixelConverter(pixelFormat_);
+    const bool reducedDecode = (converter != nullptr || pixelFormat_ == V4L2_PIX_FMT_MJPEG) && !fullDecode;
+    const bool dcPlane = reducedDecode && pixelFormat_ == V4L2_PIX_FMT_MJPEG && options_.dctDetection;
+    const int scale = dcPlane ? 8 : reducedDecode ? options_.decodeScale : 1;
+    const int channels = dcPlane || (reducedDecode && options_.grayscale) ? 1 : 3;
+    const int outWidth = (width_ + scale - 1) / scale;
+    const int outHeight = (height_ + scale - 1) / scale;
+
+    // Process the frame, storage comes from the pool and is fully overwritten below
+    const size_t outSize = static_cast<size_t>(outWidth) * static_cast<size_t>(outHeight) * channels;
+    FramePool& pool = FramePool::Instance();
+    FrameData* frame = pool.Acquire(outWidth, outHeight, pixelFormat_, outSize);
+    frame->scale = scale;
+    frame->channels = channels;
+    frame->timestampUs = timestampUs;
+    frame->sequence = buf.sequence;
+    frame->ageMs = HasMonotonicTimestamp(buf) ? static_cast<double>(MonotonicNowUs() - timestampUs) / 1000.0 : 0.0;
+
+    // Drops a frame we failed to decode while keeping the driver buffer in rotation
+    auto discardFrame = [&]() {
+        pool.Release(frame);
+        sequence_.CountDiscarded();
+        try {
+            QueueBuffer(buf);
+        } catch (const std::exception& err) {
+            LOG_LNX_ERR("Failed to requeue buffer " << buf.index << ": " << err.what());
+        }
+    };
 
-        frame->dataSize = frame->buffer.size();
+    if (converter != nullptr) {
+        const size_t frameSize = converter->frameSize(width_, height_);
+        if (buffers_[buf.index]->length < frameSize) {
+            LOG_LNX_ERR("Buffer " << buf.index << " holds " << buffers_[buf.index]->length << " bytes, "
+                        << FourccToString(pixelFormat_) << " " << width_ << "x" << height_ << " needs " << frameSize);
+            discardFrame();
+            return nullptr;
+        }
+        const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index]->start);
+        if (converter_) {
+            converter_->Convert(*converter, src, frame->data, width_, height_, channels, scale);
+        } else {
+            ConvertPixels(*converter, src, frame->data, width_, height_, channels, scale, 0, outHeight);
+        }
+    } else if (dcPlane) {
+        if (!DecodeDcPlane(static_cast<uint8_t*>(buffers_[buf.index]->start), buf.bytesused,
+                           frame->data, outWidth, outHeight)) {
+            LOG_LNX_ERR("Failed to read MJPEG coefficients");
+            discardFrame();
+            return nullptr;
+        }
     } else if (pixelFormat_ == V4L2_PIX_FMT_MJPEG) {
         const uint8_t* mjpegData = static_cast<uint8_t*>(buffers_[buf.index]->start);
         size_t mjpegSize = buf.bytesused;
@@ -658,7 +1053,7 @@ FrameData* LinuxCapture::GetFrame() {
         if (setjmp(jerr.setjmpBuffer)) {
             jpeg_destroy_decompress(&cinfo);
             LOG_LNX_ERR("Failed to decode MJPEG frame");
-            delete frame;
+            discardFrame();
             return nullptr;
         }
 
@@ -668,87 +1063,54 @@ FrameData* LinuxCapture::GetFrame() {
         if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
             jpeg_destroy_decompress(&cinfo);
             LOG_LNX_ERR("Invalid MJPEG header");
-            delete frame;
+            discardFrame();
             return nullptr;
         }
 
-        cinfo.out_color_space = JCS_RGB;
+        cinfo.out_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = static_cast<unsigned int>(scale);
+        if (reducedDecode) {
+            // Detection doesn't need the accurate IDCT or smooth chroma upsampling
+            cinfo.dct_method = JDCT_IFAST;
+            cinfo.do_fancy_upsampling = FALSE;
+        }
 
         jpeg_start_decompress(&cinfo);
 
-        if (static_cast<int>(cinfo.output_width) != width_ || static_cast<int>(cinfo.output_height) != height_) {
-            LOG_LNX_ERR("MJPEG dimensions mismatch: expected " << width_ << "x" << height_
+        if (static_cast<int>(cinfo.output_width) != outWidth || static_cast<int>(cinfo.output_height) != outHeight) {
+            LOG_LNX_ERR("MJPEG dimensions mismatch: expected " << outWidth << "x" << outHeight
                          << ", got " << cinfo.output_width << "x" << cinfo.output_height);
         }
 
         size_t rowStride = cinfo.output_width * cinfo.output_components;
-        frame->buffer.resize(static_cast<size_t>(cinfo.output_height) * rowStride);
+        size_t decodedSize = static_cast<size_t>(cinfo.output_height) * rowStride;
+        if (decodedSize > frame->capacity) {
+            jpeg_destroy_decompress(&cinfo);
+            LOG_LNX_ERR("MJPEG frame larger than negotiated format, dropping it");
+            discardFrame();
+            return nullptr;
+        }
 
         while (cinfo.output_scanline < cinfo.output_height) {
-            unsigned char* rowPtr = frame->buffer.data() + cinfo.output_scanline * rowStride;
+            unsigned char* rowPtr = frame->data + cinfo.output_scanline * rowStride;
             jpeg_read_scanlines(&cinfo, &rowPtr, 1);
         }
 
         jpeg_finish_decompress(&cinfo);
         jpeg_destroy_decompress(&cinfo);
 
-        frame->dataSize = frame->buffer.size();
-    } else if (pixelFormat_ == V4L2_PIX_FMT_GREY) {
-        // Convert GREY (grayscale) to RGB
-        size_t expectedSize = static_cast<size_t>(width_) * static_cast<size_t>(height_) * 3;
-        frame->buffer.resize(expectedSize);
-        const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index]->start);
-        uint8_t* dst = frame->buffer.data();
-
-        for (int i = 0; i < width_ * height_; ++i) {
-            uint8_t greyValue = src[i];
-            dst[i * 3 + 0] = greyValue; // R
-            dst[i * 3 + 1] = greyValue; // G
-            dst[i * 3 + 2] = greyValue; // B
-        }
-
-        frame->dataSize = frame->buffer.size();
-    } else if (pixelFormat_ == V4L2_PIX_FMT_NV12) {
-        // Convert NV12 to RGB
-        size_t expectedSize = static_cast<size_t>(width_) * static_cast<size_t>(height_) * 3;
-        frame->buffer.resize(expectedSize);
-        const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index]->start);
-        uint8_t* dst = frame->buffer.data();
-
-        // NV12 format: Y plane followed by interleaved UV plane
-        const uint8_t* yPlane = src;
-        const uint8_t* uvPlane = src + (width_ * height_);
-
-        for (int y = 0; y < height_; ++y) {
-            for (int x = 0; x < width_; ++x) {
-                int yIndex = y * width_ + x;
-                int uvIndex = (y / 2) * width_ + (x & ~1);
-                
-                uint8_t yValue = yPlane[yIndex];
-                uint8_t uValue = uvPlane[uvIndex];
-                uint8_t vValue = uvPlane[uvIndex + 1];
-
-                auto rgb = YuvToRgb(yValue, uValue, vValue);
-
-                size_t rgbIndex = yIndex * 3;
-                dst[rgbIndex + 0] = rgb[0]; // R
-                dst[rgbIndex + 1] = rgb[1]; // G
-                dst[rgbIndex + 2] = rgb[2]; // B
-            }
-        }
-
-        frame->dataSize = frame->buffer.size();
-    } else {
-        // Unknown format, copy raw data as-is
-        frame->buffer.resize(buf.bytesused);
-        memcpy(frame->buffer.data(), buffers_[buf.index]->start, buf.bytesused);
-        frame->dataSize = frame->buffer.size();
+        frame->dataSize = decodedSize;
     }
 
 //     LOG_LNX("Captured frame from buffer " << buf.index
 //             << " (" << frame->dataSize << " bytes, " << frame->width
 //             << "x" << frame->height << ")");
 
+    if (options_.rawFrames > 0) {
+        frame->rawFrame = TakeRawFrame(buf);
+    }
+
     // Requeue the buffer
     try {
         QueueBuffer(buf);
@@ -759,17 +1121,235 @@ FrameData* LinuxCapture::GetFrame() {
     return frame;
 }
 
+FrameData* LinuxCapture::TakeRawFrame(v4l2_buffer& buf) {
+    FramePool& pool = FramePool::Instance();
+    const size_t capacity = buffers_[buf.index]->length;
+    const size_t used = buf.bytesused > 0 ? std::min<size_t>(buf.bytesused, capacity) : capacity;
+    FrameData* raw = nullptr;
+
+    if (userPtr_ && rawLoans_->fetch_sub(1) > 0) {
+        // The filled ring buffer leaves with the frame and a fresh pool buffer is queued in its slot
+        try {
+            FrameData* replacement = pool.Acquire(width_, height_, pixelFormat_, ringFrameSize_, true);
+            raw = ringFrames_[buf.index];
+            raw->rawLoans = rawLoans_;
+            ringFrames_[buf.index] = replacement;
+            buffers_[buf.index]->start = replacement->data;
+            buf.m.userptr = reinterpret_cast<unsigned long>(replacement->data);
+            buf.length = static_cast<uint32_t>(ringFrameSize_);
+            rawLent_.fetch_add(1);
+        } catch (const std::bad_alloc&) {
+            rawLoans_->fetch_add(1);
+        }
+    } else if (userPtr_) {
+        rawLoans_->fetch_add(1);
+    }
+
+    if (raw == nullptr) {
+        // MMAP buffers never leave the driver, and neither does the ring once JS holds every loan
+        try {
+            raw = pool.Acquire(width_, height_, pixelFormat_, capacity, true);
+        } catch (const std::bad_alloc&) {
+            LOG_LNX_ERR("Out of memory copying raw frame " << buf.sequence);
+            return nullptr;
+        }
+        memcpy(raw->data, buffers_[buf.index]->start, used);
+        rawCopied_.fetch_add(1);
+    }
+
+    raw->dataSize = used;
+    raw->timestampUs = BufferTimestampUs(buf);
+    raw->sequence = buf.sequence;
+    return raw;
+}
+
 // N-API Implementation
 namespace Capture {
-    static std::unique_ptr<LinuxCapture> g_capture;
-    static std::thread g_captureThread;
-    static std::atomic<bool> g_isCapturing{false};
-    static Napi::ThreadSafeFunction g_callbackFunction;
+    // Per-environment state, so every worker_thread loading the addon gets its own sessions
+    struct InstanceData {
+        Napi::FunctionReference sessionClass;
+        // Session behind the module level start()/stop()/getFrame(), created on first use
+        Napi::ObjectReference defaultSession;
+        // Capturing sessions, for listAvailableCameras() and stopping them on teardown
+        std::set<CaptureSession*> running;
+    };
+
+    static InstanceData& GetInstanceData(Napi::Env env) {
+        return *GetAddonData(env).capture;
+    }
+
+    // Wraps the converted frame as an external buffer, the FrameData goes back to the pool when it is collected
+    static Napi::Object FrameToObject(Napi::Env env, FrameData* frame) {
+        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::NewOrCopy(
+            env,
+            frame->data,
+            frame->dataSize,
+            [](Napi::Env, uint8_t*, FrameData* owner) { FramePool::Instance().Release(owner); },
+            frame
+        );
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("buffer", buffer);
+        result.Set("width", frame->width);
+        result.Set("height", frame->height);
+        result.Set("dataSize", static_cast<double>(frame->dataSize));
+        result.Set("timestampUs", static_cast<double>(frame->timestampUs));
+        result.Set("sequence", static_cast<double>(frame->sequence));
+        result.Set("ageMs", frame->ageMs);
+        result.Set("lateMs", frame->lateMs);
+        result.Set("scale", frame->scale);
+        result.Set("channels", frame->channels);
+
+        // The raw source gets a buffer of its own, so JS may keep it longer than the converted frame
+        FrameData* raw = frame->rawFrame;
+        if (raw != nullptr) {
+            frame->rawFrame = nullptr;
+            Napi::Object rawObject = Napi::Object::New(env);
+            rawObject.Set("buffer", Napi::Buffer<uint8_t>::NewOrCopy(
+                env,
+                raw->data,
+                raw->dataSize,
+                [](Napi::Env, uint8_t*, FrameData* owner) { FramePool::Instance().Release(owner); },
+                raw
+            ));
+            rawObject.Set("format", Napi::String::New(env, FourccToString(raw->format)));
+            rawObject.Set("width", raw->width);
+            rawObject.Set("height", raw->height);
+            rawObject.Set("dataSize", static_cast<double>(raw->dataSize));
+            result.Set("raw", rawObject);
+        }
+        return result;
+    }
+
+    static CaptureOptions ParseCaptureOptions(Napi::Env env, const Napi::Value& value) {
+        CaptureOptions options;
+        if (value.IsUndefined() || value.IsNull()) {
+            return options;
+        }
+        if (!value.IsObject()) {
+            throw Napi::TypeError::New(env, "Capture options must be an object");
+        }
+
+        Napi::Object obj = value.As<Napi::Object>();
+        Napi::Value bufferCount = obj.Get("bufferCount");
+        if (bufferCount.IsNumber()) {
+            options.bufferCount = bufferCount.As<Napi::Number>().Int32Value();
+            if (options.bufferCount < 1 || options.bufferCount > 32) {
+                throw Napi::RangeError::New(env, "bufferCount must be between 1 and 32");
+            }
+        }
+        Napi::Value latestFrameOnly = obj.Get("latestFrameOnly");
+        if (latestFrameOnly.IsBoolean()) {
+            options.latestFrameOnly = latestFrameOnly.As<Napi::Boolean>().Value();
+        }
+        Napi::Value minWidth = obj.Get("minWidth");
+        if (minWidth.IsNumber()) {
+            options.minWidth = minWidth.As<Napi::Number>().Int32Value();
+        }
+        Napi::Value minHeight = obj.Get("minHeight");
+        if (minHeight.IsNumber()) {
+            options.minHeight = minHeight.As<Napi::Number>().Int32Value();
+        }
+        if (options.minWidth < 0 || options.minHeight < 0) {
+            throw Napi::RangeError::New(env, "minWidth and minHeight must not be negative");
+        }
+        Napi::Value decodeScale = obj.Get("decodeScale");
+        if (decodeScale.IsNumber()) {
+            options.decodeScale = decodeScale.As<Napi::Number>().Int32Value();
+            if (options.decodeScale != 1 && options.decodeScale != 2 &&
+                options.decodeScale != 4 && options.decodeScale != 8) {
+                throw Napi::RangeError::New(env, "decodeScale must be 1, 2, 4 or 8");
+            }
+        }
+        Napi::Value grayscale = obj.Get("grayscale");
+        if (grayscale.IsBoolean()) {
+            options.grayscale = grayscale.As<Napi::Boolean>().Value();
+        }
+        Napi::Value dctDetection = obj.Get("dctDetection");
+        if (dctDetection.IsBoolean()) {
+            options.dctDetection = dctDetection.As<Napi::Boolean>().Value();
+        }
+        Napi::Value conversionThreads = obj.Get("conversionThreads");
+        if (conversionThreads.IsNumber()) {
+            options.conversionThreads = conversionThreads.As<Napi::Number>().Int32Value();
+            if (options.conversionThreads < 0 || options.conversionThreads > 64) {
+                throw Napi::RangeError::New(env, "conversionThreads must be between 0 and 64");
+            }
+        }
+        Napi::Value stallTimeoutMs = obj.Get("stallTimeoutMs");
+        if (stallTimeoutMs.IsNumber()) {
+            options.stallTimeoutMs = stallTimeoutMs.As<Napi::Number>().Int32Value();
+            if (options.stallTimeoutMs < 100 || options.stallTimeoutMs > 60000) {
+                throw Napi::RangeError::New(env, "stallTimeoutMs must be between 100 and 60000");
+            }
+        }
+        Napi::Value reconnect = obj.Get("reconnect");
+        if (reconnect.IsBoolean()) {
+            options.reconnect = reconnect.As<Napi::Boolean>().Value();
+        }
+        Napi::Value userPtr = obj.Get("userPtr");
+        if (userPtr.IsBoolean()) {
+            options.userPtr = userPtr.As<Napi::Boolean>().Value();
+        }
+        Napi::Value rawFrames = obj.Get("rawFrames");
+        if (rawFrames.IsNumber()) {
+            options.rawFrames = rawFrames.As<Napi::Number>().Int32Value();
+            if (options.rawFrames < 0 || options.rawFrames > 32) {
+                throw Napi::RangeError::New(env, "rawFrames must be between 0 and 32");
+            }
+        }
+        return options;
+    }
+
+    static Napi::Object SelectionToObject(Napi::Env env, const CaptureFormatSelection& selection) {
+        const CaptureMode& mode = selection.mode;
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("format", Napi::String::New(env, FourccToString(mode.pixelFormat)));
+        result.Set("width", mode.width);
+        result.Set("height", mode.height);
+        if (mode.intervalNumerator > 0 && mode.intervalDenominator > 0) {
+            result.Set("fps", static_cast<double>(mode.intervalDenominator) / mode.intervalNumerator);
+        }
+        result.Set("negotiated", selection.negotiated);
+        result.Set("reason", Napi::String::New(env, selection.reason));
+        return result;
+    }
+
+    // Camera another session of this environment is streaming from, it reports its actual mode
+    static const LinuxCapture* FindStreaming(Napi::Env env, const std::string& devicePath) {
+        for (CaptureSession* session : GetInstanceData(env).running) {
+            const LinuxCapture* capture = session->GetCapture();
+            if (capture != nullptr && capture->GetDeviceName() == devicePath) {
+                return capture;
+            }
+        }
+        return nullptr;
+    }
+
+    static CaptureSession* DefaultSession(Napi::Env env) {
+        InstanceData& data = GetInstanceData(env);
+        if (data.defaultSession.IsEmpty()) {
+            data.defaultSession = Napi::Persistent(data.sessionClass.New({}));
+        }
+        return CaptureSession::Unwrap(data.defaultSession.Value());
+    }
 
     Napi::Value ListAvailableCameras(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        auto cameras = GetAvailableCameras();
+        // Same options start() takes plus frameRate, so the reported mode is the one start() would pick
+        CaptureOptions options = ParseCaptureOptions(env, info[0]);
+        CaptureFormatRequest request;
+        request.minWidth = options.minWidth;
+        request.minHeight = options.minHeight;
+        if (info[0].IsObject()) {
+            Napi::Value frameRate = info[0].As<Napi::Object>().Get("frameRate");
+            if (frameRate.IsNumber()) {
+                request.fps = frameRate.As<Napi::Number>().DoubleValue();
+            }
+        }
+
+        auto cameras = CameraIndex::Instance().GetCameras();
         Napi::Array result = Napi::Array::New(env, cameras.size());
 
         uint32_t index = 0;
@@ -777,188 +1357,529 @@ namespace Capture {
             Napi::Object camera = Napi::Object::New(env);
             camera.Set("name", Napi::String::New(env, entry.first));
             camera.Set("path", Napi::String::New(env, entry.second));
+            // A running camera reports the mode it is actually streaming in
+            const LinuxCapture* active = FindStreaming(env, entry.second);
+            CaptureFormatSelection selection = active != nullptr
+                ? active->GetFormatSelection()
+                : CameraIndex::Instance().ProbeFormat(entry.second, request);
+            camera.Set("selectedMode", SelectionToObject(env, selection));
             result.Set(index++, camera);
         }
 
         return result;
     }
 
+    Napi::Value GetFramePoolStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        FramePoolStats stats = FramePool::Instance().GetStats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("hits", static_cast<double>(stats.hits));
+        result.Set("misses", static_cast<double>(stats.misses));
+        result.Set("outstanding", static_cast<double>(stats.outstanding));
+        result.Set("highWater", static_cast<double>(stats.highWater));
+        result.Set("cached", static_cast<double>(stats.cached));
+        return result;
+    }
+
     Napi::Object Init(Napi::Env env, Napi::Object exports) {
+        auto* data = new InstanceData();
+        Napi::Function sessionClass = CaptureSession::Define(env);
+        data->sessionClass = Napi::Persistent(sessionClass);
+        GetAddonData(env).capture = data;
+        // Capture threads must not outlive the environment, a worker_thread exiting stops its cameras here
+        env.AddCleanupHook([data]() {
+            std::set<CaptureSession*> running;
+            running.swap(data->running);
+            for (CaptureSession* session : running) {
+                session->Shutdown(false);
+            }
+            delete data;
+        });
+
+        exports.Set(Napi::String::New(env, "CaptureSession"), sessionClass);
         exports.Set(Napi::String::New(env, "start"), Napi::Function::New(env, Capture::Start));
         exports.Set(Napi::String::New(env, "stop"), Napi::Function::New(env, Capture::Stop));
         exports.Set(Napi::String::New(env, "getFrame"), Napi::Function::New(env, Capture::GetFrame));
         exports.Set(Napi::String::New(env, "listAvailableCameras"), Napi::Function::New(env, Capture::ListAvailableCameras));
+        exports.Set(Napi::String::New(env, "getFramePoolStats"), Napi::Function::New(env, Capture::GetFramePoolStats));
+        exports.Set(Napi::String::New(env, "getCaptureStats"), Napi::Function::New(env, Capture::GetCaptureStats));
+        exports.Set(Napi::String::New(env, "captureSnapshot"), Napi::Function::New(env, Capture::CaptureSnapshot));
+        exports.Set(Napi::String::New(env, "getConversionStats"), Napi::Function::New(env, Capture::GetConversionStats));
         return exports;
     }
 
+    // The module level capture API drives one default session per environment
     Napi::Value Start(const Napi::CallbackInfo& info) {
-        Napi::Env env = info.Env();
+        return DefaultSession(info.Env())->Start(info);
+    }
 
-        if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsFunction()) {
-            Napi::TypeError::New(env, "Expected deviceName (string), frameRate (number), and callback (function)")
-                .ThrowAsJavaScriptException();
-            return env.Null();
-        }
+    Napi::Value Stop(const Napi::CallbackInfo& info) {
+        return DefaultSession(info.Env())->Stop(info);
+    }
 
-        std::string deviceName = info[0].As<Napi::String>();
-        int frameRate = info[1].As<Napi::Number>().Int32Value();
-        
-        // Store the callback
-        g_callbackFunction = Napi::ThreadSafeFunction::New(
-            env,
-            info[2].As<Napi::Function>(),
-            "FrameCallback",
-            0,
-            1
-        );
+    Napi::Value GetFrame(const Napi::CallbackInfo& info) {
+        return DefaultSession(info.Env())->GetFrame(info);
+    }
+
+    Napi::Value CaptureSnapshot(const Napi::CallbackInfo& info) {
+        return DefaultSession(info.Env())->CaptureSnapshot(info);
+    }
+
+    Napi::Value GetCaptureStats(const Napi::CallbackInfo& info) {
+        return DefaultSession(info.Env())->GetCaptureStats(info);
+    }
+
+    Napi::Value GetConversionStats(const Napi::CallbackInfo& info) {
+        return DefaultSession(info.Env())->GetConversionStats(info);
+    }
+}
+
+Napi::Function CaptureSession::Define(Napi::Env env) {
+    return DefineClass(env, "CaptureSession", {
+        InstanceMethod("start", &CaptureSession::Start),
+        InstanceMethod("stop", &CaptureSession::Stop),
+        InstanceMethod("getFrame", &CaptureSession::GetFrame),
+        InstanceMethod("captureSnapshot", &CaptureSession::CaptureSnapshot),
+        InstanceMethod("getCaptureStats", &CaptureSession::GetCaptureStats),
+        InstanceMethod("getConversionStats", &CaptureSession::GetConversionStats),
+    });
+}
 
-        // Create and start capture
-        g_capture = std::make_unique<LinuxCapture>();
-        g_capture->SetEnv(env);
+CaptureSession::CaptureSession(const Napi::CallbackInfo& info) : Napi::ObjectWrap<CaptureSession>(info) {}
 
+CaptureSession::~CaptureSession() {
+    // A capturing session is pinned, so by now stop() or the environment teardown already stopped it
+    Shutdown(false);
+}
+
+Napi::Value CaptureSession::Start(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsNumber() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected deviceName (string), frameRate (number), and callback (function)")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string deviceName = info[0].As<Napi::String>();
+    double frameRate = info[1].As<Napi::Number>().DoubleValue();
+    if (frameRate <= 0) {
+        Napi::RangeError::New(env, "frameRate must be positive").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    CaptureOptions options = Capture::ParseCaptureOptions(env, info[3]);
+    if (info.Length() > 4 && !info[4].IsUndefined() && !info[4].IsFunction()) {
+        Napi::TypeError::New(env, "Event callback must be a function").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Restarting replaces the running session instead of leaking its thread
+    try {
+        Shutdown(true);
+    } catch (const std::exception& error) {
+        LOG_LNX_ERR("Failed to stop previous capture session: " << error.what());
+    }
+
+    // Store the callback
+    callback_ = Napi::ThreadSafeFunction::New(
+        env,
+        info[2].As<Napi::Function>(),
+        "CaptureCallback",
+        0,
+        1
+    );
+
+    // Create and start capture
+    capture_ = std::make_unique<LinuxCapture>();
+    capture_->SetEnv(env);
+    capture_->SetOptions(options);
+
+    try {
+        LOG_LNX("Attempting to open device: " << deviceName);
+        capture_->OpenDevice(deviceName);
+        LOG_LNX("Successfully opened device: " << capture_->GetDeviceName());
+
+        // Start capture with camera's preferred resolution
+        capture_->StartCapture(frameRate);
+    } catch (const Napi::Error& error) {
+        capture_.reset();
+        callback_.Release();
+        callback_ = Napi::ThreadSafeFunction();
+        error.ThrowAsJavaScriptException();
+        return env.Null();
+    } catch (const std::exception& error) {
+        capture_.reset();
+        callback_.Release();
+        callback_ = Napi::ThreadSafeFunction();
+        Napi::Error::New(env, error.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Frames older than one pacing period when JS picks them up count as stale
+    mailbox_.Reset(static_cast<int64_t>(1000000.0 / frameRate));
+    reconnects_ = 0;
+    lastReconnectMs_ = 0;
+    if (info.Length() > 4 && info[4].IsFunction()) {
+        eventCallback_ = Napi::Persistent(info[4].As<Napi::Function>());
+    } else {
+        eventCallback_.Reset();
+    }
+
+    // The capture thread and queued callbacks point at this object, so it must not be collected while capturing
+    Ref();
+    Capture::GetInstanceData(env).running.insert(this);
+    capturing_ = true;
+    thread_ = std::thread(&CaptureSession::CaptureLoop, this);
+
+    return env.Undefined();
+}
+
+void CaptureSession::CaptureLoop() {
+    const CaptureOptions& options = capture_->GetOptions();
+    const int64_t stallUs = static_cast<int64_t>(options.stallTimeoutMs) * 1000;
+
+    while (capturing_) {
+        ServeSnapshotRequest();
+
+        // No sleeping here: GetFrame blocks until the driver has a frame and the pacer
+        // decides which of them are converted, so the cadence follows capture timestamps
+        FrameData* frame = nullptr;
+        std::string lost;
         try {
-            LOG_LNX("Attempting to open device: " << deviceName);
-            g_capture->OpenDevice(deviceName);
-            LOG_LNX("Successfully opened device: " << g_capture->GetDeviceName());
-
-            // Start capture with camera's preferred resolution
-            g_capture->StartCapture(frameRate);
-        } catch (const Napi::Error& error) {
-            g_isCapturing = false;
-            g_capture.reset();
-            g_callbackFunction.Release();
-            error.ThrowAsJavaScriptException();
-            return env.Null();
+            frame = capture_->GetFrame();
         } catch (const std::exception& error) {
-            g_isCapturing = false;
-            g_capture.reset();
-            g_callbackFunction.Release();
-            Napi::Error::New(env, error.what()).ThrowAsJavaScriptException();
-            return env.Null();
-        }
-
-        // Start capture thread
-        g_isCapturing = true;
-        g_captureThread = std::thread([]() {
-            while (Capture::g_isCapturing) {
-                FrameData* frame = nullptr;
-                try {
-                    frame = Capture::g_capture->GetFrame();
-                } catch (const Napi::Error& error) {
-                    LOG_LNX_ERR("GetFrame error: " << error.Message());
-                } catch (const std::exception& error) {
-                    LOG_LNX_ERR("GetFrame error: " << error.what());
-                }
+            LOG_LNX_ERR("GetFrame error: " << error.what());
+            lost = error.what();
+        }
 
-                if (frame) {
-                    auto callback = [](Napi::Env env, Napi::Function jsCallback, FrameData* frameData) {
-                        if (frameData) {
-                            // Create a buffer from the frame data
-                            Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                                env, 
-                                frameData->buffer.data(), 
-                                frameData->buffer.size()
-                            );
-                            
-                            // Create result object
-                            Napi::Object result = Napi::Object::New(env);
-                            result.Set("buffer", buffer);
-                            result.Set("width", frameData->width);
-                            result.Set("height", frameData->height);
-                            result.Set("dataSize", static_cast<double>(frameData->dataSize));
-                            
-                            // Call the JavaScript callback
-                            jsCallback.Call({ result });
-                            
-                            // Clean up
-                            delete frameData;
-                        }
-                    };
-                    
-                    // Create a copy of the frame data for the callback
-                    FrameData* frameCopy = new FrameData();
-                    frameCopy->buffer = frame->buffer;
-                    frameCopy->width = frame->width;
-                    frameCopy->height = frame->height;
-                    frameCopy->dataSize = frame->dataSize;
-                    
-                    Capture::g_callbackFunction.BlockingCall(frameCopy, callback);
-                    delete frame;
-                }
-                // Use the configured FPS instead of hardcoded 30 FPS
-                int configuredFps = Capture::g_capture->GetFps();
-                if (configuredFps > 0) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1000 / configuredFps));
-                } else {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 30)); // fallback to 30 FPS
-                }
+        // Unplugged cameras fail the dequeue, wedged ones just stop delivering buffers
+        if (lost.empty() && frame == nullptr && capturing_ &&
+            MonotonicNowUs() - capture_->LastBufferUs() > stallUs) {
+            lost = "No frame for " + std::to_string(options.stallTimeoutMs) + "ms";
+        }
+        if (!lost.empty()) {
+            if (options.reconnect) {
+                Reconnect(lost);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
-        });
+            continue;
+        }
 
-        return env.Undefined();
+        if (frame) {
+            // Latest wins: an unconsumed frame is replaced instead of queueing behind a busy JS thread
+            FrameData* replaced = mailbox_.Post(frame);
+            if (replaced != nullptr) {
+                FramePool::Instance().Release(replaced);
+            } else {
+                // The slot was empty, so no delivery is pending yet
+                callback_.NonBlockingCall(this, [](Napi::Env env, Napi::Function jsCallback, CaptureSession* self) {
+                    self->DeliverFrame(env, jsCallback);
+                });
+            }
+        }
     }
+}
 
-    Napi::Value Stop(const Napi::CallbackInfo& info) {
-        Napi::Env env = info.Env();
-        
-        Capture::g_isCapturing = false;
-        if (Capture::g_captureThread.joinable()) {
-            Capture::g_captureThread.join();
-        }
-        
+void CaptureSession::Reconnect(const std::string& reason) {
+    constexpr int kInitialDelayMs = 100;
+    constexpr int kMaxDelayMs = 2000;
+
+    const int64_t lostUs = MonotonicNowUs();
+    const std::string device = capture_->GetDeviceName();
+    auto elapsedMs = [lostUs] { return static_cast<double>(MonotonicNowUs() - lostUs) / 1000.0; };
+
+    LOG_LNX_ERR("Lost " << device << ": " << reason << ", reconnecting");
+    PostEvent({"lost", device, 0, 0, reason});
+
+    int delayMs = kInitialDelayMs;
+    for (int attempt = 1; capturing_; ++attempt) {
         try {
-            if (Capture::g_capture) {
-                Capture::g_capture->StopCapture();
-                Capture::g_capture.reset();
-            }
-        } catch (const Napi::Error& error) {
-            Capture::g_capture.reset();
-            Capture::g_callbackFunction.Release();
-            error.ThrowAsJavaScriptException();
-            return env.Null();
+            capture_->Reconnect();
+            const double durationMs = elapsedMs();
+            reconnects_.fetch_add(1);
+            lastReconnectMs_ = durationMs;
+            LOG_LNX("Reconnected " << capture_->GetDeviceName() << " after " << attempt << " attempts in " << durationMs << "ms");
+            PostEvent({"reconnected", capture_->GetDeviceName(), attempt, durationMs, ""});
+            return;
         } catch (const std::exception& error) {
-            Capture::g_capture.reset();
-            Capture::g_callbackFunction.Release();
-            Napi::Error::New(env, error.what()).ThrowAsJavaScriptException();
-            return env.Null();
+            LOG_LNX_ERR("Reconnect attempt " << attempt << " failed: " << error.what());
+            PostEvent({"retry", device, attempt, elapsedMs(), error.what()});
         }
-        
-        Capture::g_callbackFunction.Release();
-        
-        return env.Undefined();
+
+        std::unique_lock<std::mutex> lock(reconnectMutex_);
+        reconnectWake_.wait_for(lock, std::chrono::milliseconds(delayMs), [this] { return !capturing_; });
+        delayMs = std::min(delayMs * 2, kMaxDelayMs);
     }
+}
 
-    Napi::Value GetFrame(const Napi::CallbackInfo& info) {
-        Napi::Env env = info.Env();
-        
-        if (!Capture::g_capture) {
-            return env.Null();
-        }
-        
-        auto frame = Capture::g_capture->GetFrame();
-        if (!frame) {
-            return env.Null();
-        }
-        
-        // Create a buffer from the frame data
-        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-            env, 
-            frame->buffer.data(), 
-            frame->buffer.size()
-        );
-        
-        // Create result object
+void CaptureSession::PostEvent(CaptureEvent event) {
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        // One queued call drains everything posted before it runs
+        schedule = events_.empty();
+        events_.push_back(std::move(event));
+    }
+    if (schedule) {
+        callback_.NonBlockingCall(this, [](Napi::Env env, Napi::Function, CaptureSession* self) {
+            self->DeliverEvents(env);
+        });
+    }
+}
+
+// Runs on the JS thread, events go out in the order the capture thread posted them
+void CaptureSession::DeliverEvents(Napi::Env env) {
+    std::vector<CaptureEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        events.swap(events_);
+    }
+    if (eventCallback_.IsEmpty()) {
+        return;
+    }
+    for (const CaptureEvent& event : events) {
         Napi::Object result = Napi::Object::New(env);
-        result.Set("buffer", buffer);
-        result.Set("width", frame->width);
-        result.Set("height", frame->height);
-        result.Set("dataSize", static_cast<double>(frame->dataSize));
-        
-        // Clean up
-        delete frame;
-        
-        return result;
+        result.Set("type", Napi::String::New(env, event.type));
+        result.Set("device", Napi::String::New(env, event.device));
+        result.Set("attempt", event.attempt);
+        result.Set("durationMs", event.durationMs);
+        if (!event.message.empty()) {
+            result.Set("message", Napi::String::New(env, event.message));
+        }
+        eventCallback_.Call({ result });
     }
+}
 
+// Runs on the JS thread, picks up whatever frame is newest at that moment
+void CaptureSession::DeliverFrame(Napi::Env env, Napi::Function jsCallback) {
+    FrameData* frame = mailbox_.Take(MonotonicNowUs());
+    if (frame != nullptr) {
+        jsCallback.Call({ Capture::FrameToObject(env, frame) });
+    }
+}
+
+// Runs on the JS thread, settles every promise that was waiting for this snapshot
+void CaptureSession::ResolveSnapshot(Napi::Env env) {
+    SnapshotResult result;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (!snapshotDone_) {
+            return;
+        }
+        result = snapshotResult_;
+        error = snapshotError_;
+        snapshotResult_ = SnapshotResult();
+        snapshotError_.clear();
+        snapshotDone_ = false;
+    }
+
+    std::vector<Napi::Promise::Deferred> deferreds;
+    deferreds.swap(snapshotDeferreds_);
+    if (result.frame == nullptr) {
+        for (auto& deferred : deferreds) {
+            deferred.Reject(Napi::Error::New(env, error).Value());
+        }
+        return;
+    }
+    if (deferreds.empty()) {
+        FramePool::Instance().Release(result.frame);
+        return;
+    }
+
+    Napi::Object snapshot = Capture::FrameToObject(env, result.frame);
+    snapshot.Set("switchMs", result.switchMs);
+    snapshot.Set("restoreMs", result.restoreMs);
+    for (auto& deferred : deferreds) {
+        deferred.Resolve(snapshot);
+    }
+}
+
+// Capture thread side of captureSnapshot()
+void CaptureSession::ServeSnapshotRequest() {
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (!snapshotRequested_) {
+            return;
+        }
+    }
 
+    SnapshotResult result;
+    std::string error;
+    try {
+        result = capture_->CaptureSnapshot([this] { return !capturing_; });
+    } catch (const std::exception& err) {
+        LOG_LNX_ERR("Snapshot error: " << err.what());
+        error = err.what();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        // Requests that arrived while switching are answered with this frame too
+        snapshotRequested_ = false;
+        FramePool::Instance().Release(snapshotResult_.frame);
+        snapshotResult_ = result;
+        snapshotError_ = error;
+        snapshotDone_ = true;
+    }
+    callback_.NonBlockingCall(this, [](Napi::Env env, Napi::Function, CaptureSession* self) {
+        self->ResolveSnapshot(env);
+    });
+}
+
+// Tears down the running session without waiting on the driver or the JS queue:
+// Wake() kicks the capture thread out of epoll_wait and Abort() makes pending and
+// future TSFN calls fail fast, so the join below takes microseconds
+void CaptureSession::Shutdown(bool fromJs) {
+    const bool wasCapturing = capturing_.exchange(false);
+    if (capture_) {
+        capture_->Wake();
+    }
+    {
+        // Cuts a reconnect backoff short, the lock orders this after the predicate check
+        std::lock_guard<std::mutex> lock(reconnectMutex_);
+    }
+    reconnectWake_.notify_all();
+    if (callback_) {
+        callback_.Abort();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    callback_ = Napi::ThreadSafeFunction();
+    FramePool::Instance().Release(mailbox_.Clear());
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        events_.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        FramePool::Instance().Release(snapshotResult_.frame);
+        snapshotResult_ = SnapshotResult();
+        snapshotRequested_ = false;
+        snapshotDone_ = false;
+    }
+    std::vector<Napi::Promise::Deferred> deferreds;
+    deferreds.swap(snapshotDeferreds_);
+    // Teardown and finalizers can't call into JS any more, and the cleanup hook already emptied the running set
+    if (fromJs) {
+        for (auto& deferred : deferreds) {
+            deferred.Reject(Napi::Error::New(deferred.Env(), "Capture stopped before the snapshot was taken").Value());
+        }
+        if (wasCapturing) {
+            Capture::GetInstanceData(Env()).running.erase(this);
+            Unref();
+        }
+    }
+
+    if (capture_) {
+        std::unique_ptr<LinuxCapture> capture = std::move(capture_);
+        capture->StopCapture();
+    }
+}
+
+Napi::Value CaptureSession::Stop(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        Shutdown(true);
+    } catch (const Napi::Error& error) {
+        error.ThrowAsJavaScriptException();
+        return env.Null();
+    } catch (const std::exception& error) {
+        Napi::Error::New(env, error.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value CaptureSession::GetFrame(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!capture_) {
+        return env.Null();
+    }
+
+    auto frame = capture_->GetFrame();
+    if (!frame) {
+        return env.Null();
+    }
+
+    return Capture::FrameToObject(env, frame);
+}
+
+Napi::Value CaptureSession::CaptureSnapshot(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+    if (!capture_ || !capturing_) {
+        deferred.Reject(Napi::Error::New(env, "Capture is not running").Value());
+        return deferred.Promise();
+    }
+    // Nothing to switch to, the caller keeps using the frames it already has
+    if (!capture_->NeedsSnapshot()) {
+        deferred.Resolve(env.Null());
+        return deferred.Promise();
+    }
+
+    snapshotDeferreds_.push_back(deferred);
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (!snapshotRequested_) {
+            snapshotRequested_ = true;
+            wake = true;
+        }
+    }
+    if (wake) {
+        capture_->Wake();
+    }
+    return deferred.Promise();
+}
+
+Napi::Value CaptureSession::GetCaptureStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    FrameMailboxStats stats = mailbox_.GetStats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("delivered", static_cast<double>(stats.delivered));
+    result.Set("overwritten", static_cast<double>(stats.overwritten));
+    result.Set("stale", static_cast<double>(stats.stale));
+
+    FrameSequenceStats sequence = capture_ ? capture_->GetSequenceStats() : FrameSequenceStats{};
+    result.Set("driverDrops", static_cast<double>(sequence.driverDrops));
+    result.Set("skipped", static_cast<double>(sequence.skipped));
+    result.Set("discarded", static_cast<double>(sequence.discarded));
+    RawFrameStats raw = capture_ ? capture_->GetRawFrameStats() : RawFrameStats{};
+    result.Set("rawLent", static_cast<double>(raw.lent));
+    result.Set("rawCopied", static_cast<double>(raw.copied));
+    result.Set("reconnects", static_cast<double>(reconnects_.load()));
+    result.Set("lastReconnectMs", lastReconnectMs_.load());
+    return result;
+}
+
+Napi::Value CaptureSession::GetConversionStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!capture_) {
+        return env.Null();
+    }
+    ParallelConvertStats stats = capture_->GetConversionStats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("threads", static_cast<double>(stats.threads));
+    result.Set("parallelFrames", static_cast<double>(stats.parallelFrames));
+    result.Set("serialFrames", static_cast<double>(stats.serialFrames));
+    result.Set("lastFrameMs", stats.lastFrameMs);
+    Napi::Array lastBandMs = Napi::Array::New(env, stats.lastBandMs.size());
+    for (size_t i = 0; i < stats.lastBandMs.size(); ++i) {
+        lastBandMs.Set(static_cast<uint32_t>(i), stats.lastBandMs[i]);
+    }
+    result.Set("lastBandMs", lastBandMs);
+    result.Set("avgBandMs", stats.avgBandMs);
+    result.Set("maxBandMs", stats.maxBandMs);
+    return result;
 }
@@ -0,0 +1,321 @@
+#include "capture_format.h"
+#include "converter_registry.h"
+#include "logger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+    int xioctl(int fd, unsigned long request, void* arg) {
+        int r;
+        do {
+            r = ioctl(fd, request, arg);
+        } while (r == -1 && errno == EINTR);
+        return r;
+    }
+
+    // Relative work to turn one pixel of the format into a detection frame, 0 when it can't be converted
+    int PixelCost(uint32_t pixelFormat) {
+        if (pixelFormat == V4L2_PIX_FMT_MJPEG) {
+            return 8;
+        }
+        const PixelConverter* converter = FindPixelConverter(pixelFormat);
+        return converter != nullptr ? converter->cost : 0;
+    }
+
+    double ModeFps(const CaptureMode& mode) {
+        if (mode.intervalNumerator == 0 || mode.intervalDenominator == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(mode.intervalDenominator) / static_cast<double>(mode.intervalNumerator);
+    }
+
+    // Smallest value >= target on a stepwise range, or max when the target is out of range
+    int StepwiseAtLeast(int target, int minimum, int maximum, int step) {
+        if (target <= minimum) {
+            return minimum;
+        }
+        if (target >= maximum || step <= 0) {
+            return maximum;
+        }
+        int steps = (target - minimum + step - 1) / step;
+        return std::min(maximum, minimum + steps * step);
+    }
+
+    void AddIntervals(int fd, CaptureMode mode, std::vector<CaptureMode>& modes) {
+        v4l2_frmivalenum ival = {};
+        ival.pixel_format = mode.pixelFormat;
+        ival.width = static_cast<uint32_t>(mode.width);
+        ival.height = static_cast<uint32_t>(mode.height);
+
+        bool any = false;
+        for (ival.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ++ival.index) {
+            if (ival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+                mode.intervalNumerator = ival.discrete.numerator;
+                mode.intervalDenominator = ival.discrete.denominator;
+                modes.push_back(mode);
+                any = true;
+            } else {
+                // Continuous/stepwise: offer both ends, the selection picks whichever fits the target fps
+                mode.intervalNumerator = ival.stepwise.min.numerator;
+                mode.intervalDenominator = ival.stepwise.min.denominator;
+                modes.push_back(mode);
+                mode.intervalNumerator = ival.stepwise.max.numerator;
+                mode.intervalDenominator = ival.stepwise.max.denominator;
+                modes.push_back(mode);
+                any = true;
+                break;
+            }
+        }
+
+        if (!any) {
+            mode.intervalNumerator = 0;
+            mode.intervalDenominator = 0;
+            modes.push_back(mode);
+        }
+    }
+
+    std::string DescribeMode(const CaptureMode& mode) {
+        std::ostringstream oss;
+        oss << FourccToString(mode.pixelFormat) << " " << mode.width << "x" << mode.height;
+        double fps = ModeFps(mode);
+        if (fps > 0) {
+            oss << " @ " << fps << "fps";
+        }
+        return oss.str();
+    }
+}
+
+std::string FourccToString(uint32_t fourcc) {
+    std::string result;
+    for (int shift = 0; shift < 32; shift += 8) {
+        result.push_back(static_cast<char>((fourcc >> shift) & 0xFF));
+    }
+    return result;
+}
+
+bool IsSupportedPixelFormat(uint32_t pixelFormat) {
+    return PixelCost(pixelFormat) > 0;
+}
+
+std::vector<CaptureMode> EnumerateCaptureModes(int fd, const CaptureFormatRequest& request) {
+    std::vector<CaptureMode> modes;
+
+    v4l2_fmtdesc fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (fmt.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; ++fmt.index) {
+        CaptureMode mode;
+        mode.pixelFormat = fmt.pixelformat;
+
+        v4l2_frmsizeenum size = {};
+        size.pixel_format = fmt.pixelformat;
+        for (size.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; ++size.index) {
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                mode.width = static_cast<int>(size.discrete.width);
+                mode.height = static_cast<int>(size.discrete.height);
+                AddIntervals(fd, mode, modes);
+            } else {
+                // Continuous/stepwise sizes: the smallest size covering the request, and the largest one
+                const auto& sw = size.stepwise;
+                mode.width = StepwiseAtLeast(request.minWidth, static_cast<int>(sw.min_width),
+                                             static_cast<int>(sw.max_width), static_cast<int>(sw.step_width));
+                mode.height = StepwiseAtLeast(request.minHeight, static_cast<int>(sw.min_height),
+                                              static_cast<int>(sw.max_height), static_cast<int>(sw.step_height));
+                AddIntervals(fd, mode, modes);
+                mode.width = static_cast<int>(sw.max_width);
+                mode.height = static_cast<int>(sw.max_height);
+                AddIntervals(fd, mode, modes);
+                break;
+            }
+        }
+    }
+
+    return modes;
+}
+
+CaptureFormatSelection SelectCaptureFormat(const std::vector<CaptureMode>& modes, const CaptureFormatRequest& request) {
+    CaptureFormatSelection selection;
+    const CaptureMode* best = nullptr;
+    uint64_t bestCost = 0;
+    size_t candidates = 0;
+
+    auto covers = [&request](const CaptureMode& mode) {
+        return IsSupportedPixelFormat(mode.pixelFormat) &&
+               mode.width >= request.minWidth && mode.height >= request.minHeight;
+    };
+    auto reaches = [&request](const CaptureMode& mode) {
+        return request.fps <= 0 || ModeFps(mode) >= request.fps;
+    };
+    // A cheap mode that can't keep up with the frame rate loses to a costlier one that can. Only when none
+    // reaches it does cost alone decide
+    const bool rateReachable = std::any_of(modes.begin(), modes.end(), [&](const CaptureMode& mode) {
+        return covers(mode) && reaches(mode);
+    });
+
+    for (const auto& mode : modes) {
+        if (!covers(mode) || (rateReachable && !reaches(mode))) {
+            continue;
+        }
+        ++candidates;
+
+        uint64_t cost = static_cast<uint64_t>(mode.width) * static_cast<uint64_t>(mode.height) *
+                        static_cast<uint64_t>(PixelCost(mode.pixelFormat));
+        if (best == nullptr || cost < bestCost) {
+            best = &mode;
+            bestCost = cost;
+            continue;
+        }
+        if (cost > bestCost || mode.pixelFormat != best->pixelFormat ||
+            mode.width != best->width || mode.height != best->height) {
+            continue;
+        }
+
+        // Same format and size: prefer the slowest rate that still reaches the target, frames above it
+        // are only dropped by the pacer, otherwise get as close to the target as possible
+        double fps = ModeFps(mode);
+        double bestFps = ModeFps(*best);
+        bool meets = fps >= request.fps;
+        bool bestMeets = bestFps >= request.fps;
+        if ((meets && (!bestMeets || fps < bestFps)) || (!meets && !bestMeets && fps > bestFps)) {
+            best = &mode;
+        }
+    }
+
+    std::ostringstream reason;
+    if (best == nullptr) {
+        reason << "no supported mode of at least " << request.minWidth << "x" << request.minHeight
+               << " among " << modes.size() << " advertised, keeping driver default";
+        selection.reason = reason.str();
+        return selection;
+    }
+
+    selection.negotiated = true;
+    selection.mode = *best;
+    reason << DescribeMode(*best) << ": cheapest of " << candidates << " supported modes covering "
+           << request.minWidth << "x" << request.minHeight;
+    if (request.fps > 0) {
+        reason << (rateReachable ? " at " : ", none reaching ") << request.fps << "fps";
+    }
+    reason << " (cost " << bestCost << ")";
+    double fps = ModeFps(*best);
+    if (fps > 0 && request.fps > 0) {
+        reason << (fps >= request.fps ? ", slowest rate reaching " : ", fastest rate available for ")
+               << request.fps << "fps";
+    }
+    selection.reason = reason.str();
+    return selection;
+}
+
+CaptureFormatSelection SelectFullResolutionFormat(const std::vector<CaptureMode>& modes) {
+    CaptureFormatSelection selection;
+    const CaptureMode* best = nullptr;
+
+    for (const auto& mode : modes) {
+        if (!IsSupportedPixelFormat(mode.pixelFormat)) {
+            continue;
+        }
+        if (best == nullptr) {
+            best = &mode;
+            continue;
+        }
+        int64_t area = static_cast<int64_t>(mode.width) * mode.height;
+        int64_t bestArea = static_cast<int64_t>(best->width) * best->height;
+        if (area > bestArea || (area == bestArea && PixelCost(mode.pixelFormat) < PixelCost(best->pixelFormat))) {
+            best = &mode;
+        }
+    }
+
+    if (best == nullptr) {
+        selection.reason = "no supported mode advertised";
+        return selection;
+    }
+
+    selection.negotiated = true;
+    selection.mode = *best;
+    // Only one frame is taken, the interval is left to the driver
+    selection.mode.intervalNumerator = 0;
+    selection.mode.intervalDenominator = 0;
+    selection.reason = DescribeMode(selection.mode) + ": largest supported mode";
+    return selection;
+}
+
+DeviceFormats ReadDeviceFormats(int fd, const CaptureFormatRequest& request) {
+    DeviceFormats formats;
+    formats.modes = EnumerateCaptureModes(fd, request);
+    formats.minWidth = request.minWidth;
+    formats.minHeight = request.minHeight;
+    v4l2_format fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd, VIDIOC_G_FMT, &fmt) == 0) {
+        formats.driverDefault.pixelFormat = fmt.fmt.pix.pixelformat;
+        formats.driverDefault.width = static_cast<int>(fmt.fmt.pix.width);
+        formats.driverDefault.height = static_cast<int>(fmt.fmt.pix.height);
+    }
+    return formats;
+}
+
+DeviceFormats ProbeDeviceFormats(const std::string& devicePath, const CaptureFormatRequest& request) {
+    int fd = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        DeviceFormats formats;
+        formats.error = std::string("cannot open device: ") + strerror(errno);
+        return formats;
+    }
+
+    DeviceFormats formats = ReadDeviceFormats(fd, request);
+    close(fd);
+    return formats;
+}
+
+CaptureFormatSelection ResolveCaptureFormat(const DeviceFormats& formats, const CaptureFormatRequest& request) {
+    if (!formats.error.empty()) {
+        CaptureFormatSelection selection;
+        selection.reason = formats.error;
+        return selection;
+    }
+
+    if (request.minWidth > 0 || request.minHeight > 0) {
+        CaptureFormatSelection selection = SelectCaptureFormat(formats.modes, request);
+        if (selection.negotiated) {
+            return selection;
+        }
+        LOG_LNX_ERR("Format negotiation: " << selection.reason);
+    }
+
+    CaptureFormatSelection selection;
+    selection.mode = formats.driverDefault;
+
+    if (!IsSupportedPixelFormat(selection.mode.pixelFormat)) {
+        // Raw bytes of an unknown format would be compared as RGB, move to a supported one,
+        // keeping the current size when the driver offers it
+        CaptureFormatRequest fallback = request;
+        fallback.minWidth = std::max(request.minWidth, selection.mode.width);
+        fallback.minHeight = std::max(request.minHeight, selection.mode.height);
+        CaptureFormatSelection supported = SelectCaptureFormat(formats.modes, fallback);
+        if (!supported.negotiated) {
+            supported = SelectCaptureFormat(formats.modes, request);
+        }
+        if (supported.negotiated) {
+            supported.reason = DescribeMode(selection.mode) + " has no converter, switching to " + supported.reason;
+            return supported;
+        }
+    }
+
+    selection.reason = DescribeMode(selection.mode) + ": driver default, " +
+                       (request.minWidth > 0 || request.minHeight > 0
+                            ? std::string("no supported mode covers the minimum detection resolution")
+                            : std::string("no minimum detection resolution configured"));
+    return selection;
+}
+
+CaptureFormatSelection ResolveCaptureFormat(int fd, const CaptureFormatRequest& request) {
+    return ResolveCaptureFormat(ReadDeviceFormats(fd, request), request);
+}
@@ -0,0 +1,286 @@
+#include "converter_registry.h"
+
+#include <linux/videodev2.h>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+    // BT.601 studio range YUV to RGB in 8.8 fixed point, same formula as the scalar kernels in pixel_convert.cc.
+    // The rounding constant is folded into the Y table
+    struct YuvTables {
+        std::array<int32_t, 256> y;
+        std::array<int32_t, 256> rv;
+        std::array<int32_t, 256> gu;
+        std::array<int32_t, 256> gv;
+        std::array<int32_t, 256> bu;
+    };
+
+    constexpr YuvTables MakeYuvTables() {
+        YuvTables tables = {};
+        for (int i = 0; i < 256; ++i) {
+            tables.y[i] = 298 * (i - 16) + 128;
+            tables.rv[i] = 409 * (i - 128);
+            tables.gu[i] = -100 * (i - 128);
+            tables.gv[i] = -208 * (i - 128);
+            tables.bu[i] = 516 * (i - 128);
+        }
+        return tables;
+    }
+
+    // Sums above land in [-277, 534] after the shift, the clamp table covers [-384, 640)
+    constexpr int kClampOffset = 384;
+
+    constexpr std::array<uint8_t, 1024> MakeClampTable() {
+        std::array<uint8_t, 1024> table = {};
+        for (int i = 0; i < 1024; ++i) {
+            table[i] = static_cast<uint8_t>(std::min(std::max(i - kClampOffset, 0), 255));
+        }
+        return table;
+    }
+
+    // Full range luma of RGB sources, the weights add up to 256 so grey stays grey
+    struct LumaTables {
+        std::array<uint16_t, 256> r;
+        std::array<uint16_t, 256> g;
+        std::array<uint16_t, 256> b;
+    };
+
+    constexpr LumaTables MakeLumaTables() {
+        LumaTables tables = {};
+        for (int i = 0; i < 256; ++i) {
+            tables.r[i] = static_cast<uint16_t>(77 * i + 128);
+            tables.g[i] = static_cast<uint16_t>(150 * i);
+            tables.b[i] = static_cast<uint16_t>(29 * i);
+        }
+        return tables;
+    }
+
+    constexpr YuvTables kYuvTables = MakeYuvTables();
+    constexpr std::array<uint8_t, 1024> kClamp = MakeClampTable();
+    constexpr LumaTables kLumaTables = MakeLumaTables();
+
+    inline void StoreYuvAsRgb(uint8_t y, uint8_t u, uint8_t v, uint8_t* dst) {
+        const int32_t luma = kYuvTables.y[y];
+        dst[0] = kClamp[((luma + kYuvTables.rv[v]) >> 8) + kClampOffset];
+        dst[1] = kClamp[((luma + kYuvTables.gu[u] + kYuvTables.gv[v]) >> 8) + kClampOffset];
+        dst[2] = kClamp[((luma + kYuvTables.bu[u]) >> 8) + kClampOffset];
+    }
+
+    inline uint8_t RgbToLuma(uint8_t r, uint8_t g, uint8_t b) {
+        return static_cast<uint8_t>((kLumaTables.r[r] + kLumaTables.g[g] + kLumaTables.b[b]) >> 8);
+    }
+
+    // Source layouts. A layout is constructed per output row and reads one pixel at a time:
+    // YUV layouts expose Luma() and Chroma(), the others Rgb()
+
+    // Packed 4:2:2, two pixels in four bytes
+    template <int Y0, int U, int V>
+    struct Packed422 {
+        static constexpr bool kYuv = true;
+        static size_t FrameSize(int width, int height) { return static_cast<size_t>(width) * height * 2; }
+
+        const uint8_t* row;
+        Packed422(const uint8_t* src, int width, int, int y) : row(src + static_cast<size_t>(y) * width * 2) {}
+        uint8_t Luma(int x) const { return row[x * 2 + Y0]; }
+        void Chroma(int x, uint8_t& u, uint8_t& v) const {
+            const uint8_t* pair = row + (x & ~1) * 2;
+            u = pair[U];
+            v = pair[V];
+        }
+    };
+
+    // Y plane followed by one interleaved chroma plane at half resolution
+    template <int U, int V>
+    struct SemiPlanar420 {
+        static constexpr bool kYuv = true;
+        static size_t FrameSize(int width, int height) { return static_cast<size_t>(width) * height * 3 / 2; }
+
+        const uint8_t* yRow;
+        const uint8_t* uvRow;
+        SemiPlanar420(const uint8_t* src, int width, int height, int y)
+            : yRow(src + static_cast<size_t>(y) * width),
+              uvRow(src + static_cast<size_t>(width) * height + static_cast<size_t>(y / 2) * width) {}
+        uint8_t Luma(int x) const { return yRow[x]; }
+        void Chroma(int x, uint8_t& u, uint8_t& v) const {
+            u = uvRow[(x & ~1) + U];
+            v = uvRow[(x & ~1) + V];
+        }
+    };
+
+    // Y, U and V planes, chroma at half resolution in both directions (I420)
+    struct Planar420 {
+        static constexpr bool kYuv = true;
+        static size_t FrameSize(int width, int height) {
+            return static_cast<size_t>(width) * height +
+                   2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+        }
+
+        const uint8_t* yRow;
+        const uint8_t* uRow;
+        const uint8_t* vRow;
+        Planar420(const uint8_t* src, int width, int height, int y) {
+            const size_t chromaWidth = static_cast<size_t>((width + 1) / 2);
+            const size_t chromaPlane = chromaWidth * ((height + 1) / 2);
+            yRow = src + static_cast<size_t>(y) * width;
+            uRow = src + static_cast<size_t>(width) * height + (y / 2) * chromaWidth;
+            vRow = uRow + chromaPlane;
+        }
+        uint8_t Luma(int x) const { return yRow[x]; }
+        void Chroma(int x, uint8_t& u, uint8_t& v) const {
+            u = uRow[x / 2];
+            v = vRow[x / 2];
+        }
+    };
+
+    // GREY is replicated into RGB rather than treated as studio range Y, matching greyToRgb
+    struct Grey {
+        static constexpr bool kYuv = false;
+        static size_t FrameSize(int width, int height) { return static_cast<size_t>(width) * height; }
+
+        const uint8_t* row;
+        Grey(const uint8_t* src, int width, int, int y) : row(src + static_cast<size_t>(y) * width) {}
+        void Rgb(int x, uint8_t& r, uint8_t& g, uint8_t& b) const { r = g = b = row[x]; }
+    };
+
+    template <int R, int G, int B>
+    struct Packed24 {
+        static constexpr bool kYuv = false;
+        static size_t FrameSize(int width, int height) { return static_cast<size_t>(width) * height * 3; }
+
+        const uint8_t* row;
+        Packed24(const uint8_t* src, int width, int, int y) : row(src + static_cast<size_t>(y) * width * 3) {}
+        void Rgb(int x, uint8_t& r, uint8_t& g, uint8_t& b) const {
+            const uint8_t* pixel = row + x * 3;
+            r = pixel[R];
+            g = pixel[G];
+            b = pixel[B];
+        }
+    };
+
+    // 8-bit Bayer mosaic with red at (RX, RY) of every 2x2 quad. Each pixel takes the colours of its quad,
+    // the two greens averaged; detection doesn't need a finer demosaic
+    template <int RX, int RY>
+    struct Bayer8 {
+        static constexpr bool kYuv = false;
+        static size_t FrameSize(int width, int height) { return static_cast<size_t>(width) * height; }
+
+        const uint8_t* rows[2];
+        int lastX;
+        Bayer8(const uint8_t* src, int width, int height, int y) : lastX(width - 1) {
+            const int top = y & ~1;
+            rows[0] = src + static_cast<size_t>(top) * width;
+            rows[1] = src + static_cast<size_t>(std::min(top + 1, height - 1)) * width;
+        }
+        void Rgb(int x, uint8_t& r, uint8_t& g, uint8_t& b) const {
+            const int left = x & ~1;
+            const int columns[2] = {left, std::min(left + 1, lastX)};
+            r = rows[RY][columns[RX]];
+            b = rows[1 - RY][columns[1 - RX]];
+            g = static_cast<uint8_t>((rows[RY][columns[1 - RX]] + rows[1 - RY][columns[RX]] + 1) >> 1);
+        }
+    };
+
+    // Output layouts
+    struct RgbOutput {
+        static constexpr int kChannels = 3;
+
+        template <typename Source>
+        static void Store(const Source& source, int x, uint8_t* dst) {
+            if constexpr (Source::kYuv) {
+                uint8_t u, v;
+                source.Chroma(x, u, v);
+                StoreYuvAsRgb(source.Luma(x), u, v, dst);
+            } else {
+                source.Rgb(x, dst[0], dst[1], dst[2]);
+            }
+        }
+    };
+
+    struct LumaOutput {
+        static constexpr int kChannels = 1;
+
+        template <typename Source>
+        static void Store(const Source& source, int x, uint8_t* dst) {
+            if constexpr (Source::kYuv) {
+                dst[0] = source.Luma(x);
+            } else {
+                uint8_t r, g, b;
+                source.Rgb(x, r, g, b);
+                dst[0] = RgbToLuma(r, g, b);
+            }
+        }
+    };
+
+    // Downscaled is a separate instantiation so the full resolution loops see a constant step of 1
+    template <typename Source, typename Output, bool Downscaled>
+    void ConvertFrame(const uint8_t* src, uint8_t* dst, int width, int height, int scale, int firstRow, int lastRow) {
+        const int step = Downscaled ? scale : 1;
+        const int outWidth = (width + step - 1) / step;
+        dst += static_cast<size_t>(firstRow) * outWidth * Output::kChannels;
+        for (int row = firstRow; row < lastRow; ++row) {
+            const Source source(src, width, height, row * step);
+            for (int x = 0; x < width; x += step) {
+                Output::Store(source, x, dst);
+                dst += Output::kChannels;
+            }
+        }
+    }
+
+    template <typename Source>
+    size_t FrameSize(int width, int height) {
+        return Source::FrameSize(width, height);
+    }
+
+    template <typename Source>
+    constexpr PixelConverter MakeConverter(uint32_t pixelFormat, int cost, RowKernel ConvertKernels::*rgbKernel) {
+        return {
+            pixelFormat,
+            cost,
+            &FrameSize<Source>,
+            &ConvertFrame<Source, RgbOutput, false>,
+            &ConvertFrame<Source, LumaOutput, false>,
+            &ConvertFrame<Source, RgbOutput, true>,
+            &ConvertFrame<Source, LumaOutput, true>,
+            rgbKernel,
+        };
+    }
+
+    const PixelConverter kConverters[] = {
+        MakeConverter<Grey>(V4L2_PIX_FMT_GREY, 1, &ConvertKernels::greyToRgb),
+        MakeConverter<Packed24<0, 1, 2>>(V4L2_PIX_FMT_RGB24, 1, nullptr),
+        MakeConverter<Packed24<2, 1, 0>>(V4L2_PIX_FMT_BGR24, 2, nullptr),
+        MakeConverter<SemiPlanar420<0, 1>>(V4L2_PIX_FMT_NV12, 2, &ConvertKernels::nv12ToRgb),
+        MakeConverter<SemiPlanar420<1, 0>>(V4L2_PIX_FMT_NV21, 2, nullptr),
+        MakeConverter<Planar420>(V4L2_PIX_FMT_YUV420, 2, nullptr),
+        MakeConverter<Packed422<0, 1, 3>>(V4L2_PIX_FMT_YUYV, 3, &ConvertKernels::yuyvToRgb),
+        MakeConverter<Packed422<1, 0, 2>>(V4L2_PIX_FMT_UYVY, 3, nullptr),
+        MakeConverter<Bayer8<0, 0>>(V4L2_PIX_FMT_SRGGB8, 4, nullptr),
+        MakeConverter<Bayer8<1, 0>>(V4L2_PIX_FMT_SGRBG8, 4, nullptr),
+        MakeConverter<Bayer8<0, 1>>(V4L2_PIX_FMT_SGBRG8, 4, nullptr),
+        MakeConverter<Bayer8<1, 1>>(V4L2_PIX_FMT_SBGGR8, 4, nullptr),
+    };
+}
+
+const PixelConverter* FindPixelConverter(uint32_t pixelFormat) {
+    for (const auto& converter : kConverters) {
+        if (converter.pixelFormat == pixelFormat) {
+            return &converter;
+        }
+    }
+    return nullptr;
+}
+
+void ConvertPixels(const PixelConverter& converter, const uint8_t* src, uint8_t* dst,
+                   int width, int height, int channels, int scale, int firstRow, int lastRow) {
+    if (scale > 1) {
+        (channels == 1 ? converter.downscaledLuma : converter.downscaledRgb)(src, dst, width, height, scale,
+                                                                            firstRow, lastRow);
+    } else if (channels == 1) {
+        converter.luma(src, dst, width, height, 1, firstRow, lastRow);
+    } else if (converter.rgbKernel != nullptr) {
+        (GetConvertKernels().*converter.rgbKernel)(src, dst, width, height, firstRow, lastRow);
+    } else {
+        converter.rgb(src, dst, width, height, 1, firstRow, lastRow);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "capture_format.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Video capture devices by display name. Enumerating opens every /dev/video* node, so it runs once and
+// again only after inotify reports a video node appearing, disappearing or changing permissions in /dev or
+// /sys/class/video4linux. Without inotify every lookup enumerates like before
+class CameraIndex {
+public:
+    // Process-wide index, never destroyed
+    static CameraIndex& Instance();
+
+    CameraIndex(const CameraIndex&) = delete;
+    CameraIndex& operator=(const CameraIndex&) = delete;
+
+    // Display name -> device path, sorted by name
+    std::map<std::string, std::string> GetCameras();
+    // Device path of an exact display name, else of a case-insensitive one. An indexed device path resolves
+    // to itself, anything else to an empty string
+    std::string FindPath(const std::string& name);
+    // Mode start() would pick on an indexed device. The advertised modes are probed once per device and
+    // request size and kept until the index goes stale, so listing cameras doesn't open them again
+    CaptureFormatSelection ProbeFormat(const std::string& path, const CaptureFormatRequest& request);
+    // Drops the cached modes of a device whose driver format we are about to change
+    void ForgetFormats(const std::string& path);
+
+private:
+    CameraIndex();
+
+    // Both with mutex_ held
+    void Refresh();
+    void DrainEvents();
+
+    std::mutex mutex_;
+    int inotifyFd_ = -1;
+    bool stale_ = true;
+    std::map<std::string, std::string> cameras_;
+    std::unordered_map<std::string, std::string> pathByName_;
+    std::unordered_map<std::string, std::string> pathByLowerName_;
+    std::unordered_set<std::string> paths_;
+    std::unordered_map<std::string, DeviceFormats> formats_;
+};
@@ -5,60 +5,249 @@
 #include <vector>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <thread>
 #include "common.h"
+#include "frame_mailbox.h"
+#include "frame_pacer.h"
+#include "frame_sequence.h"
+#include "capture_format.h"
+#include "parallel_convert.h"
 
 // Forward declarations
 struct v4l2_format;
 struct v4l2_buffer;
 struct buffer;
 
+// Tunables passed from JS as the optional 4th argument of start()
+struct CaptureOptions {
+    // Number of MMAP buffers requested from the driver
+    int bufferCount = 4;
+    // Drain every ready buffer on wakeup and only process the newest one
+    bool latestFrameOnly = false;
+    // Smallest frame detection still works on, 0x0 keeps the camera's default format
+    int minWidth = 0;
+    int minHeight = 0;
+    // Detection frames are 1/decodeScale of the native size: 1, 2, 4 or 8. MJPEG uses libjpeg's DCT scaling,
+    // raw formats are point sampled
+    int decodeScale = 1;
+    // Detection frames carry a single luma channel: MJPEG decodes with JCS_GRAYSCALE,
+    // raw formats convert to luma only and leave RGB to snapshots
+    bool grayscale = false;
+    // MJPEG detection frames are reduced to the DC coefficient of every 8x8 luma block, no IDCT
+    bool dctDetection = false;
+    // Lanes converting raw frames in row bands, the capture thread included. 0 picks one per core
+    int conversionThreads = 0;
+    // A device that delivers no buffer for this long, or fails outright, is reopened in place
+    int stallTimeoutMs = 2000;
+    bool reconnect = true;
+    // Driver buffers come from FramePool (V4L2_MEMORY_USERPTR), falls back to MMAP when the driver refuses
+    bool userPtr = false;
+    // Every converted frame carries its raw source. With userPtr up to this many ring buffers are lent out
+    // at once without copying, beyond that and with MMAP the bytes are copied. 0 delivers no raw frames
+    int rawFrames = 0;
+};
+
+// How raw frames left the capture
+struct RawFrameStats {
+    // Ring buffers lent out and replaced by a fresh pool buffer
+    uint64_t lent;
+    // Copied because the loans were used up, the pool failed to allocate or the buffers are MMAP
+    uint64_t copied;
+};
+
+// Full resolution frame taken by switching away from the detection mode for one frame
+struct SnapshotResult {
+    FrameData* frame = nullptr;
+    // From the request until the full resolution frame was converted
+    double switchMs = 0;
+    // Switching back to the detection mode afterwards
+    double restoreMs = 0;
+};
+
 class LinuxCapture {
 public:
     LinuxCapture();
     ~LinuxCapture();
 
     void OpenDevice(const std::string& deviceName);
-    void StartCapture(int fps);
+    void SetOptions(const CaptureOptions& options);
+    void StartCapture(double fps);
     void StopCapture();
     FrameData* GetFrame();
+    // Runs on the capture thread in between GetFrame() calls. Wakeups only abort it once stopRequested()
+    SnapshotResult CaptureSnapshot(const std::function<bool()>& stopRequested);
+    // False when detection frames already are full resolution RGB, fixed once capture started
+    bool NeedsSnapshot() const { return hasSnapshotMode_ || reducedDecode_; }
+    // Interrupts a GetFrame() blocked in epoll_wait, safe to call from any thread
+    void Wake();
+    // Capture thread. Drops the current handle and opens the same camera again with the same mode request,
+    // throws while it is not back. Frame pool, converter and wake fd stay
+    void Reconnect();
+    // CLOCK_MONOTONIC time of the last dequeued buffer, or of the stream start
+    int64_t LastBufferUs() const { return lastBufferUs_; }
+    const CaptureOptions& GetOptions() const { return options_; }
     bool IsCapturing() const { return isCapturing_; }
-    const std::string& GetDeviceName() const { return deviceName_; }
-    int GetFps() const { return fps_; }
+    // Copies, taken under identityMutex_: other sessions read them from the JS thread while a reconnect rewrites them
+    std::string GetDeviceName() const;
+    double GetFps() const { return fps_; }
+    CaptureFormatSelection GetFormatSelection() const;
+    ParallelConvertStats GetConversionStats() const;
+    FrameSequenceStats GetSequenceStats() const { return sequence_.GetStats(); }
+    RawFrameStats GetRawFrameStats() const { return {rawLent_.load(), rawCopied_.load()}; }
     void SetEnv(Napi::Env env);
     
 private:
-    void InitDevice(int fps);
+    enum class WaitResult { Frame, Timeout, Woken };
+
+    void InitDevice(double fps);
+    void SetFormat(const CaptureMode& mode);
+    void SetFrameRate(double fps);
+    void SwitchMode(const CaptureMode& mode, bool restoreFrameRate);
+    WaitResult WaitForBuffer(v4l2_buffer& buf);
+    FrameData* ConvertBuffer(v4l2_buffer& buf, bool fullDecode);
+    FrameData* TakeRawFrame(v4l2_buffer& buf);
     void UninitDevice();
     void StartStreaming();
     void StopStreaming();
+    void SetupWaitSet();
+    void CloseWaitSet();
+    void CloseDevice();
+    // Opens a resolved node and checks it captures video, sets fd_. Returns its bus_info
+    std::string OpenPath(const std::string& devicePath);
+    // Node of the camera that was opened, by name or by bus_info. Empty while it is not back
+    std::string FindSameDevice() const;
     
     // V4L2 helper functions
     int xioctl(int fd, unsigned long request, void* arg) const;
     void RequestBuffers();
+    bool RequestUserPtrBuffers();
+    uint32_t BufferMemory() const;
     void QueueBuffer(v4l2_buffer& buf);
     void DequeueBuffer(v4l2_buffer& buf);
+    bool TryDequeueBuffer(v4l2_buffer& buf);
+    void DrainToLatest(v4l2_buffer& buf);
     [[noreturn]] void ThrowSystemError(const std::string& message, int err) const;
     [[noreturn]] void ThrowError(const std::string& message) const;
     
     int fd_ = -1;
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
     std::vector<buffer*> buffers_;
+    // USERPTR only: pool frames backing buffers_, a lent out one is replaced in its slot
+    bool userPtr_ = false;
+    std::vector<FrameData*> ringFrames_;
+    size_t ringFrameSize_ = 0;
+    // Loans left, shared with lent frames so a late JS release still returns them
+    std::shared_ptr<std::atomic<int>> rawLoans_;
+    std::atomic<uint64_t> rawLent_{0};
+    std::atomic<uint64_t> rawCopied_{0};
     std::mutex frameMutex_;
     std::vector<uint8_t> frameData_;
     bool isCapturing_ = false;
     int width_ = 0;
     int height_ = 0;
-    int fps_ = 0;
+    double fps_ = 0;
     uint32_t pixelFormat_ = 0;
+    // Guards deviceName_ and formatSelection_, written on the capture thread and read from any thread
+    mutable std::mutex identityMutex_;
     std::string deviceName_;
+    // Name or path start() was given, reconnects resolve it again
+    std::string requestedDevice_;
+    // bus_info of the first opened node, stays the same when the camera comes back on another /dev/video
+    std::string busInfo_;
+    CaptureOptions options_;
+    // Rebuilt by SetOptions, its workers live as long as the capture object
+    std::unique_ptr<ParallelConverter> converter_;
+    CaptureFormatSelection formatSelection_;
+    CaptureMode snapshotMode_;
+    bool hasSnapshotMode_ = false;
+    bool reducedDecode_ = false;
+    FramePacer pacer_;
+    FrameSequence sequence_;
+    int64_t lastBufferUs_ = 0;
     napi_env env_ = nullptr;
+    std::thread::id envThreadId_;
+};
+
+// Watchdog report for start()'s optional 5th argument: "lost", a "retry" per failed attempt, then "reconnected"
+struct CaptureEvent {
+    std::string type;
+    std::string device;
+    int attempt = 0;
+    // Since the device was lost
+    double durationMs = 0;
+    std::string message;
+};
+
+// One camera driven from JS: its LinuxCapture, capture thread and frame delivery. Sessions are independent,
+// so one process captures from several cameras at once, each on its own thread
+class CaptureSession : public Napi::ObjectWrap<CaptureSession> {
+public:
+    static Napi::Function Define(Napi::Env env);
+
+    explicit CaptureSession(const Napi::CallbackInfo& info);
+    ~CaptureSession() override;
+
+    Napi::Value Start(const Napi::CallbackInfo& info);
+    Napi::Value Stop(const Napi::CallbackInfo& info);
+    Napi::Value GetFrame(const Napi::CallbackInfo& info);
+    Napi::Value CaptureSnapshot(const Napi::CallbackInfo& info);
+    Napi::Value GetCaptureStats(const Napi::CallbackInfo& info);
+    Napi::Value GetConversionStats(const Napi::CallbackInfo& info);
+
+    // Stops capturing; fromJs is false on environment teardown, where nothing may call into JS any more
+    void Shutdown(bool fromJs);
+    // Null while stopped
+    const LinuxCapture* GetCapture() const { return capture_.get(); }
+
+private:
+    void CaptureLoop();
+    void ServeSnapshotRequest();
+    void DeliverFrame(Napi::Env env, Napi::Function jsCallback);
+    void ResolveSnapshot(Napi::Env env);
+    // Capture thread, reopens the device with exponential backoff until it is back or the session stops
+    void Reconnect(const std::string& reason);
+    void PostEvent(CaptureEvent event);
+    void DeliverEvents(Napi::Env env);
+
+    std::unique_ptr<LinuxCapture> capture_;
+    std::thread thread_;
+    std::atomic<bool> capturing_{false};
+    Napi::ThreadSafeFunction callback_;
+    FrameMailbox mailbox_;
+
+    // Snapshot requests: the flag and result are shared with the capture thread,
+    // the deferreds are only touched on the JS thread
+    std::mutex snapshotMutex_;
+    bool snapshotRequested_ = false;
+    bool snapshotDone_ = false;
+    SnapshotResult snapshotResult_;
+    std::string snapshotError_;
+    std::vector<Napi::Promise::Deferred> snapshotDeferreds_;
+
+    // Reconnect backoff sleeps here so Shutdown() doesn't wait it out
+    std::mutex reconnectMutex_;
+    std::condition_variable reconnectWake_;
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<double> lastReconnectMs_{0};
+    // Watchdog events queued by the capture thread, the callback is only touched on the JS thread
+    std::mutex eventMutex_;
+    std::vector<CaptureEvent> events_;
+    Napi::FunctionReference eventCallback_;
 };
 
-// N-API functions
+// N-API functions, start()/stop()/getFrame() and friends drive a default CaptureSession per environment
 namespace Capture {
     Napi::Object Init(Napi::Env env, Napi::Object exports);
     Napi::Value Start(const Napi::CallbackInfo& info);
     Napi::Value Stop(const Napi::CallbackInfo& info);
     Napi::Value GetFrame(const Napi::CallbackInfo& info);
     Napi::Value ListAvailableCameras(const Napi::CallbackInfo& info);
+    Napi::Value GetFramePoolStats(const Napi::CallbackInfo& info);
+    Napi::Value GetCaptureStats(const Napi::CallbackInfo& info);
+    Napi::Value CaptureSnapshot(const Napi::CallbackInfo& info);
+    Napi::Value GetConversionStats(const Napi::CallbackInfo& info);
 }
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One pixel format / frame size / frame interval combination advertised by the driver
+struct CaptureMode {
+    uint32_t pixelFormat = 0;
+    int width = 0;
+    int height = 0;
+    // Frame interval in seconds as a fraction, 0/0 when the driver doesn't enumerate intervals
+    uint32_t intervalNumerator = 0;
+    uint32_t intervalDenominator = 0;
+};
+
+struct CaptureFormatRequest {
+    // Smallest frame that is still good enough for detection, 0x0 keeps the driver's current format
+    int minWidth = 0;
+    int minHeight = 0;
+    double fps = 0;
+};
+
+struct CaptureFormatSelection {
+    // True when the mode differs from what the driver would give us and has to be applied with S_FMT
+    bool negotiated = false;
+    CaptureMode mode;
+    std::string reason;
+};
+
+std::string FourccToString(uint32_t fourcc);
+bool IsSupportedPixelFormat(uint32_t pixelFormat);
+
+// VIDIOC_ENUM_FMT x VIDIOC_ENUM_FRAMESIZES x VIDIOC_ENUM_FRAMEINTERVALS on an open device
+std::vector<CaptureMode> EnumerateCaptureModes(int fd, const CaptureFormatRequest& request);
+
+// Cheapest supported mode that satisfies the request, cost being roughly pixels * conversion work per pixel
+CaptureFormatSelection SelectCaptureFormat(const std::vector<CaptureMode>& modes, const CaptureFormatRequest& request);
+
+// Largest supported mode, cheapest format on ties, used for full resolution snapshots
+CaptureFormatSelection SelectFullResolutionFormat(const std::vector<CaptureMode>& modes);
+
+// What a device advertises: every mode and the format the driver currently has set
+struct DeviceFormats {
+    std::vector<CaptureMode> modes;
+    CaptureMode driverDefault;
+    // Request size the stepwise sizes in modes were expanded for
+    int minWidth = 0;
+    int minHeight = 0;
+    // Set when the device could not be opened, everything else is empty then
+    std::string error;
+};
+
+// EnumerateCaptureModes plus VIDIOC_G_FMT on an open device
+DeviceFormats ReadDeviceFormats(int fd, const CaptureFormatRequest& request);
+
+// Same as ReadDeviceFormats but opens and closes the device itself, used for listing cameras
+DeviceFormats ProbeDeviceFormats(const std::string& devicePath, const CaptureFormatRequest& request);
+
+// What InitDevice will use for this request: the negotiated mode or the driver default
+CaptureFormatSelection ResolveCaptureFormat(const DeviceFormats& formats, const CaptureFormatRequest& request);
+CaptureFormatSelection ResolveCaptureFormat(int fd, const CaptureFormatRequest& request);
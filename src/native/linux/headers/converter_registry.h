@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pixel_convert.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Converts output rows [firstRow, lastRow) of one raw driver frame, scale is 1 for the full resolution layouts.
+// The whole output is ceil(width / scale) x ceil(height / scale) pixels of 3 (RGB24) or 1 (luma) bytes,
+// src and dst point at the start of the frames so disjoint row ranges can run on different threads
+using ConvertFunction = void (*)(const uint8_t* src, uint8_t* dst, int width, int height, int scale,
+                                 int firstRow, int lastRow);
+
+// Conversions for one uncompressed V4L2 pixel format, instantiated at compile time from the format's layout.
+// MJPEG goes through libjpeg and has no entry
+struct PixelConverter {
+    uint32_t pixelFormat;
+    // Relative work to turn one pixel into a detection frame, SelectCaptureFormat prefers cheap formats
+    int cost;
+    // Bytes the driver needs for one unpadded width x height frame
+    size_t (*frameSize)(int width, int height);
+    ConvertFunction rgb;
+    ConvertFunction luma;
+    // Point sampled at every scale-th pixel and row
+    ConvertFunction downscaledRgb;
+    ConvertFunction downscaledLuma;
+    // SIMD kernel used instead of rgb when present, see GetConvertKernels
+    RowKernel ConvertKernels::*rgbKernel;
+};
+
+// nullptr when the format has no converter
+const PixelConverter* FindPixelConverter(uint32_t pixelFormat);
+
+// Picks the layout for the requested channels (1 or 3) and scale, then converts output rows [firstRow, lastRow)
+void ConvertPixels(const PixelConverter& converter, const uint8_t* src, uint8_t* dst,
+                   int width, int height, int channels, int scale, int firstRow, int lastRow);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "common.h"
+
+struct FrameMailboxStats {
+    uint64_t delivered;
+    uint64_t overwritten;
+    uint64_t stale;
+};
+
+// Single-slot, latest-wins handoff from the capture thread to JS.
+// The capture thread never waits: a frame JS hasn't picked up yet is replaced by the newer one.
+class FrameMailbox {
+public:
+    // Frames older than staleAfterUs when JS takes them are counted as stale (still delivered)
+    void Reset(int64_t staleAfterUs) {
+        staleAfterUs_ = staleAfterUs;
+        delivered_ = 0;
+        overwritten_ = 0;
+        stale_ = 0;
+    }
+
+    // Capture thread. Returns the unconsumed frame that got replaced; nullptr means the
+    // slot was empty and JS has to be notified
+    FrameData* Post(FrameData* frame) {
+        FrameData* replaced = slot_.exchange(frame, std::memory_order_acq_rel);
+        if (replaced != nullptr) {
+            overwritten_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return replaced;
+    }
+
+    // JS thread. Returns the newest frame, nullptr if it was already taken
+    FrameData* Take(int64_t nowUs) {
+        FrameData* frame = slot_.exchange(nullptr, std::memory_order_acq_rel);
+        if (frame != nullptr) {
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+            if (staleAfterUs_ > 0 && nowUs - frame->timestampUs > staleAfterUs_) {
+                stale_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return frame;
+    }
+
+    // Removes whatever is left without counting it, used on shutdown
+    FrameData* Clear() {
+        return slot_.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    FrameMailboxStats GetStats() const {
+        return {
+            delivered_.load(std::memory_order_relaxed),
+            overwritten_.load(std::memory_order_relaxed),
+            stale_.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    std::atomic<FrameData*> slot_{nullptr};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> overwritten_{0};
+    std::atomic<uint64_t> stale_{0};
+    int64_t staleAfterUs_ = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Picks which driver frames to process so delivered frames follow absolute deadlines
+// (firstFrame + n * period) instead of drifting by conversion and delivery time.
+// Timestamps are CLOCK_MONOTONIC microseconds, normally taken from v4l2_buffer.timestamp.
+class FramePacer {
+public:
+    void Reset(double fps) {
+        periodUs_ = fps > 0 ? static_cast<int64_t>(std::llround(1000000.0 / fps)) : 0;
+        nextDeadlineUs_ = -1;
+        lastTimestampUs_ = -1;
+        driverIntervalUs_ = 0;
+        lastLatenessUs_ = 0;
+    }
+
+    // Returns true if the frame captured at timestampUs should be converted and delivered
+    bool ShouldProcess(int64_t timestampUs) {
+        if (lastTimestampUs_ >= 0 && timestampUs > lastTimestampUs_) {
+            driverIntervalUs_ = timestampUs - lastTimestampUs_;
+        }
+        lastTimestampUs_ = timestampUs;
+
+        if (periodUs_ <= 0 || nextDeadlineUs_ < 0) {
+            nextDeadlineUs_ = timestampUs + periodUs_;
+            lastLatenessUs_ = 0;
+            return true;
+        }
+
+        // Accept the frame closest to the deadline: anything within half a driver interval before it
+        const int64_t toleranceUs = std::min(driverIntervalUs_, periodUs_) / 2;
+        if (timestampUs + toleranceUs < nextDeadlineUs_) {
+            return false;
+        }
+
+        lastLatenessUs_ = timestampUs - nextDeadlineUs_;
+        nextDeadlineUs_ += periodUs_;
+        if (nextDeadlineUs_ <= timestampUs) {
+            // We fell more than a period behind (stall, slow driver), resync instead of bursting
+            nextDeadlineUs_ = timestampUs + periodUs_;
+        }
+        return true;
+    }
+
+    // Signed distance between the last accepted frame and its deadline
+    int64_t LastLatenessUs() const { return lastLatenessUs_; }
+
+private:
+    int64_t periodUs_ = 0;
+    int64_t nextDeadlineUs_ = -1;
+    int64_t lastTimestampUs_ = -1;
+    int64_t driverIntervalUs_ = 0;
+    int64_t lastLatenessUs_ = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+struct FrameSequenceStats {
+    // Frames the driver never handed us, counted from gaps in v4l2_buffer.sequence
+    uint64_t driverDrops;
+    // Frames we dequeued and gave back unconverted on purpose: pacing and latestFrameOnly draining
+    uint64_t skipped;
+    // Frames flagged as corrupt by the driver or that failed to decode
+    uint64_t discarded;
+    // Sequence number of the last dequeued buffer
+    uint32_t lastSequence;
+};
+
+// Tells frames lost in the driver apart from frames we drop ourselves. Written by the capture thread,
+// read from the JS thread
+class FrameSequence {
+public:
+    // New session, counters start over
+    void Reset() {
+        Restart();
+        driverDrops_ = 0;
+        skipped_ = 0;
+        discarded_ = 0;
+    }
+
+    // VIDIOC_STREAMON starts numbering from 0 again, the next buffer must not count as a gap
+    void Restart() {
+        hasLast_ = false;
+    }
+
+    // Every dequeued buffer, in dequeue order
+    void Observe(uint32_t sequence) {
+        if (hasLast_) {
+            // Unsigned, so a wrap at 2^32 still yields the right gap. A huge gap means the driver went backwards
+            const uint32_t gap = sequence - lastSequence_.load(std::memory_order_relaxed) - 1;
+            if (gap < kMaxGap) {
+                driverDrops_.fetch_add(gap, std::memory_order_relaxed);
+            }
+        }
+        hasLast_ = true;
+        lastSequence_.store(sequence, std::memory_order_relaxed);
+    }
+
+    void CountSkipped() { skipped_.fetch_add(1, std::memory_order_relaxed); }
+    void CountDiscarded() { discarded_.fetch_add(1, std::memory_order_relaxed); }
+
+    FrameSequenceStats GetStats() const {
+        return {
+            driverDrops_.load(std::memory_order_relaxed),
+            skipped_.load(std::memory_order_relaxed),
+            discarded_.load(std::memory_order_relaxed),
+            lastSequence_.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    static constexpr uint32_t kMaxGap = 1u << 31;
+
+    bool hasLast_ = false;
+    std::atomic<uint32_t> lastSequence_{0};
+    std::atomic<uint64_t> driverDrops_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> discarded_{0};
+};
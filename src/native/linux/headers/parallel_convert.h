@@ -0,0 +1,49 @@
+#pragma once
+
+#include "converter_registry.h"
+#include "worker_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ParallelConvertStats {
+    // Lanes converting one frame, the calling thread included
+    size_t threads = 1;
+    uint64_t parallelFrames = 0;
+    uint64_t serialFrames = 0;
+    // Wall time of the last converted frame
+    double lastFrameMs = 0;
+    // Time of every band of the last frame split into bands, slowest band bounds the frame
+    std::vector<double> lastBandMs;
+    double avgBandMs = 0;
+    double maxBandMs = 0;
+};
+
+// Converts raw frames in row bands spread over a WorkerPool. Frames with fewer than two bands' worth of
+// pixels, and a single lane, convert serially on the calling thread where waking the pool costs more than it saves
+class ParallelConverter {
+public:
+    // Output pixels one band has to cover at least
+    static constexpr size_t kMinBandPixels = 256 * 1024;
+    // Lanes picked when threads is 0. Every capture session has its own pool, so this bounds the threads
+    // each camera adds next to the image scheduler
+    static constexpr unsigned kMaxAutoThreads = 4;
+
+    // threads counts the calling thread, 0 uses one lane per core up to kMaxAutoThreads
+    explicit ParallelConverter(int threads);
+
+    void Convert(const PixelConverter& converter, const uint8_t* src, uint8_t* dst,
+                 int width, int height, int channels, int scale);
+    ParallelConvertStats GetStats() const;
+
+private:
+    size_t lanes_;
+    std::unique_ptr<WorkerPool> pool_;
+
+    mutable std::mutex statsMutex_;
+    ParallelConvertStats stats_;
+    uint64_t bands_ = 0;
+    double totalBandMs_ = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Kernel converting rows [firstRow, lastRow) of a width x height frame, src and dst point at the frame start
+using RowKernel = void (*)(const uint8_t* src, uint8_t* dst, int width, int height, int firstRow, int lastRow);
+
+// Packed/planar YUV and GREY to RGB24 kernels, free of Napi so they can be benchmarked standalone.
+// Every implementation produces output bit-identical to the scalar one and writes exactly the requested rows,
+// so disjoint row ranges can run on different threads
+struct ConvertKernels {
+    const char* name;
+    RowKernel yuyvToRgb;
+    RowKernel nv12ToRgb;
+    RowKernel greyToRgb;
+};
+
+// Best kernels for the running CPU, picked once on first use
+const ConvertKernels& GetConvertKernels();
+
+// Every implementation the running CPU can execute, scalar first and widest last
+std::vector<const ConvertKernels*> GetSupportedConvertKernels();
+
+// Reference implementation, also the fallback on CPUs without a vector path
+const ConvertKernels& GetScalarConvertKernels();
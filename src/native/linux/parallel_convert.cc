@@ -0,0 +1,73 @@
+#include "parallel_convert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+    size_t ResolveLanes(int threads) {
+        if (threads > 0) {
+            return static_cast<size_t>(threads);
+        }
+        unsigned cores = std::thread::hardware_concurrency();
+        return std::max(1u, std::min(cores, ParallelConverter::kMaxAutoThreads));
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+ParallelConverter::ParallelConverter(int threads) : lanes_(ResolveLanes(threads)) {
+    if (lanes_ > 1) {
+        pool_ = std::make_unique<WorkerPool>(lanes_ - 1);
+    }
+    stats_.threads = lanes_;
+}
+
+void ParallelConverter::Convert(const PixelConverter& converter, const uint8_t* src, uint8_t* dst,
+                                int width, int height, int channels, int scale) {
+    const int outWidth = (width + scale - 1) / scale;
+    const int outHeight = (height + scale - 1) / scale;
+    const size_t outPixels = static_cast<size_t>(outWidth) * static_cast<size_t>(outHeight);
+    const size_t bands = pool_ ? std::min({lanes_, outPixels / kMinBandPixels, static_cast<size_t>(outHeight)}) : 1;
+    const auto start = std::chrono::steady_clock::now();
+
+    if (bands <= 1) {
+        ConvertPixels(converter, src, dst, width, height, channels, scale, 0, outHeight);
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++stats_.serialFrames;
+        stats_.lastFrameMs = ElapsedMs(start);
+        return;
+    }
+
+    // Even rows per band with the remainder spread over the first ones, so no band is more than a row longer
+    std::vector<double> bandMs(bands);
+    const int rowsPerBand = outHeight / static_cast<int>(bands);
+    const int extraRows = outHeight % static_cast<int>(bands);
+    pool_->Run(bands, [&](size_t band) {
+        const auto bandStart = std::chrono::steady_clock::now();
+        const int index = static_cast<int>(band);
+        const int firstRow = index * rowsPerBand + std::min(index, extraRows);
+        const int lastRow = firstRow + rowsPerBand + (index < extraRows ? 1 : 0);
+        ConvertPixels(converter, src, dst, width, height, channels, scale, firstRow, lastRow);
+        bandMs[band] = ElapsedMs(bandStart);
+    });
+    const double frameMs = ElapsedMs(start);
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    ++stats_.parallelFrames;
+    stats_.lastFrameMs = frameMs;
+    for (double ms : bandMs) {
+        totalBandMs_ += ms;
+        stats_.maxBandMs = std::max(stats_.maxBandMs, ms);
+    }
+    bands_ += bands;
+    stats_.avgBandMs = totalBandMs_ / static_cast<double>(bands_);
+    stats_.lastBandMs = std::move(bandMs);
+}
+
+ParallelConvertStats ParallelConverter::GetStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
@@ -0,0 +1,376 @@
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define PIXEL_CONVERT_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXEL_CONVERT_NEON 1
+#endif
+
+namespace {
+    inline uint8_t ClampToByte(int value) {
+        return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+    }
+
+    // BT.601 limited range, 8-bit fixed point
+    inline void YuvToRgbPixel(int y, int u, int v, uint8_t* dst) {
+        int c = y - 16;
+        int d = u - 128;
+        int e = v - 128;
+
+        dst[0] = ClampToByte((298 * c + 409 * e + 128) >> 8);
+        dst[1] = ClampToByte((298 * c - 100 * d - 208 * e + 128) >> 8);
+        dst[2] = ClampToByte((298 * c + 516 * d + 128) >> 8);
+    }
+
+    // Pixels [from, width) of one YUYV row, from must be even
+    void YuyvRowScalar(const uint8_t* src, uint8_t* dst, int from, int width) {
+        for (int x = from; x < width; x += 2) {
+            const uint8_t* p = src + static_cast<size_t>(x) * 2;
+            YuvToRgbPixel(p[0], p[1], p[3], dst + static_cast<size_t>(x) * 3);
+            YuvToRgbPixel(p[2], p[1], p[3], dst + static_cast<size_t>(x) * 3 + 3);
+        }
+    }
+
+    void Nv12RowScalar(const uint8_t* yRow, const uint8_t* uvRow, uint8_t* dst, int from, int width) {
+        for (int x = from; x < width; ++x) {
+            const uint8_t* uv = uvRow + (x & ~1);
+            YuvToRgbPixel(yRow[x], uv[0], uv[1], dst + static_cast<size_t>(x) * 3);
+        }
+    }
+
+    void GreyRowScalar(const uint8_t* src, uint8_t* dst, int from, int width) {
+        for (int x = from; x < width; ++x) {
+            dst[x * 3 + 0] = src[x];
+            dst[x * 3 + 1] = src[x];
+            dst[x * 3 + 2] = src[x];
+        }
+    }
+
+    void YuyvToRgbScalar(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            YuyvRowScalar(src + static_cast<size_t>(y) * width * 2, dst + static_cast<size_t>(y) * width * 3, 0, width);
+        }
+    }
+
+    void Nv12ToRgbScalar(const uint8_t* src, uint8_t* dst, int width, int height, int firstRow, int lastRow) {
+        const uint8_t* uvPlane = src + static_cast<size_t>(width) * height;
+        for (int y = firstRow; y < lastRow; ++y) {
+            Nv12RowScalar(src + static_cast<size_t>(y) * width, uvPlane + static_cast<size_t>(y / 2) * width,
+                          dst + static_cast<size_t>(y) * width * 3, 0, width);
+        }
+    }
+
+    void GreyToRgbScalar(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        GreyRowScalar(src, dst, firstRow * width, lastRow * width);
+    }
+
+    const ConvertKernels kScalarKernels = {"scalar", YuyvToRgbScalar, Nv12ToRgbScalar, GreyToRgbScalar};
+
+#ifdef PIXEL_CONVERT_X86
+    // Writes 8 RGBx quads as 24 packed bytes without touching the byte after them
+    inline void StoreQuadsAsRgb(uint8_t* dst, const uint32_t* quads) {
+        for (int i = 0; i < 7; ++i) {
+            memcpy(dst + i * 3, quads + i, 4);
+        }
+        memcpy(dst + 21, quads + 7, 3);
+    }
+
+    // Two int16 multipliers in one int32 lane, the layout _mm_madd_epi16 expects
+    inline __m128i PairConstant(int lo, int hi) {
+        return _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16) |
+                                               static_cast<uint16_t>(lo)));
+    }
+
+    inline __m128i InterleavePairs(__m128i lo, __m128i hi) {
+        return _mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(hi, 16));
+    }
+
+    // Same arithmetic as YuvToRgbPixel on 4 pixels held in int32 lanes, SSE2 has no 32-bit multiply
+    // so every product pair goes through pmaddwd
+    inline void YuvToRgbSse2(__m128i y, __m128i u, __m128i v, __m128i& r, __m128i& g, __m128i& b) {
+        const __m128i c = _mm_sub_epi32(y, _mm_set1_epi32(16));
+        const __m128i d = _mm_sub_epi32(u, _mm_set1_epi32(128));
+        const __m128i e = _mm_sub_epi32(v, _mm_set1_epi32(128));
+        const __m128i round = _mm_set1_epi32(128);
+
+        const __m128i ce = InterleavePairs(c, e);
+        const __m128i cd = InterleavePairs(c, d);
+        const __m128i eOne = InterleavePairs(e, _mm_set1_epi32(1));
+
+        r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce, PairConstant(298, 409)), round), 8);
+        g = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, PairConstant(298, -100)),
+                                         _mm_madd_epi16(eOne, PairConstant(-208, 128))), 8);
+        b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, PairConstant(298, 516)), round), 8);
+    }
+
+    // 8 pixels given as int16 Y and U/V pairs (U0 V0 U1 V1 ...), each pair shared by two pixels
+    inline void ConvertYuv8Sse2(__m128i y16, __m128i uv16, uint8_t* dst) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i u32 = _mm_and_si128(uv16, _mm_set1_epi32(0xFFFF));
+        const __m128i v32 = _mm_srli_epi32(uv16, 16);
+
+        __m128i rLo, gLo, bLo, rHi, gHi, bHi;
+        YuvToRgbSse2(_mm_unpacklo_epi16(y16, zero), _mm_unpacklo_epi32(u32, u32), _mm_unpacklo_epi32(v32, v32),
+                     rLo, gLo, bLo);
+        YuvToRgbSse2(_mm_unpackhi_epi16(y16, zero), _mm_unpackhi_epi32(u32, u32), _mm_unpackhi_epi32(v32, v32),
+                     rHi, gHi, bHi);
+
+        // Saturating packs give the 0..255 clamp for free
+        const __m128i r8 = _mm_packus_epi16(_mm_packs_epi32(rLo, rHi), zero);
+        const __m128i g8 = _mm_packus_epi16(_mm_packs_epi32(gLo, gHi), zero);
+        const __m128i b8 = _mm_packus_epi16(_mm_packs_epi32(bLo, bHi), zero);
+
+        const __m128i rg = _mm_unpacklo_epi8(r8, g8);
+        const __m128i b0 = _mm_unpacklo_epi8(b8, zero);
+        alignas(16) uint32_t quads[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(quads), _mm_unpacklo_epi16(rg, b0));
+        _mm_store_si128(reinterpret_cast<__m128i*>(quads + 4), _mm_unpackhi_epi16(rg, b0));
+        StoreQuadsAsRgb(dst, quads);
+    }
+
+    void YuyvToRgbSse2(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* row = src + static_cast<size_t>(y) * width * 2;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 2));
+                ConvertYuv8Sse2(_mm_and_si128(packed, lowBytes), _mm_srli_epi16(packed, 8), out + x * 3);
+            }
+            YuyvRowScalar(row, out, x, width);
+        }
+    }
+
+    void Nv12ToRgbSse2(const uint8_t* src, uint8_t* dst, int width, int height, int firstRow, int lastRow) {
+        const __m128i zero = _mm_setzero_si128();
+        const uint8_t* uvPlane = src + static_cast<size_t>(width) * height;
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* yRow = src + static_cast<size_t>(y) * width;
+            const uint8_t* uvRow = uvPlane + static_cast<size_t>(y / 2) * width;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const __m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(yRow + x)), zero);
+                const __m128i uv16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(uvRow + x)), zero);
+                ConvertYuv8Sse2(y16, uv16, out + x * 3);
+            }
+            Nv12RowScalar(yRow, uvRow, out, x, width);
+        }
+    }
+
+    void GreyToRgbSse2(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        const __m128i zero = _mm_setzero_si128();
+        const int pixels = lastRow * width;
+        int x = firstRow * width;
+        for (; x + 8 <= pixels; x += 8) {
+            const __m128i grey = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x));
+            const __m128i twice = _mm_unpacklo_epi8(grey, grey);
+            const __m128i once = _mm_unpacklo_epi8(grey, zero);
+            alignas(16) uint32_t quads[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(quads), _mm_unpacklo_epi16(twice, once));
+            _mm_store_si128(reinterpret_cast<__m128i*>(quads + 4), _mm_unpackhi_epi16(twice, once));
+            StoreQuadsAsRgb(dst + static_cast<size_t>(x) * 3, quads);
+        }
+        GreyRowScalar(src, dst, x, pixels);
+    }
+
+    const ConvertKernels kSse2Kernels = {"sse2", YuyvToRgbSse2, Nv12ToRgbSse2, GreyToRgbSse2};
+
+    // AVX2 has 32-bit multiplies, min/max and byte shuffles, so 8 pixels fit one register end to end
+    __attribute__((target("avx2")))
+    inline void StoreRgb8Avx2(__m256i r, __m256i g, __m256i b, uint8_t* dst) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max = _mm256_set1_epi32(255);
+        r = _mm256_min_epi32(_mm256_max_epi32(r, zero), max);
+        g = _mm256_min_epi32(_mm256_max_epi32(g, zero), max);
+        b = _mm256_min_epi32(_mm256_max_epi32(b, zero), max);
+
+        const __m256i quads = _mm256_or_si256(r, _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(b, 16)));
+        // Drop every fourth byte inside each 128-bit lane, leaving 12 packed RGB bytes per lane
+        const __m256i packed = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+        alignas(32) uint8_t bytes[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(bytes), packed);
+        memcpy(dst, bytes, 12);
+        memcpy(dst + 12, bytes + 16, 12);
+    }
+
+    __attribute__((target("avx2")))
+    inline void ConvertYuv8Avx2(__m128i y8, __m128i u8, __m128i v8, uint8_t* dst) {
+        const __m256i c = _mm256_sub_epi32(_mm256_cvtepu8_epi32(y8), _mm256_set1_epi32(16));
+        const __m256i d = _mm256_sub_epi32(_mm256_cvtepu8_epi32(u8), _mm256_set1_epi32(128));
+        const __m256i e = _mm256_sub_epi32(_mm256_cvtepu8_epi32(v8), _mm256_set1_epi32(128));
+        const __m256i round = _mm256_set1_epi32(128);
+        const __m256i c298 = _mm256_mullo_epi32(c, _mm256_set1_epi32(298));
+
+        const __m256i r = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(c298, _mm256_mullo_epi32(e, _mm256_set1_epi32(409))), round), 8);
+        const __m256i g = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(c298, _mm256_mullo_epi32(d, _mm256_set1_epi32(100))),
+                                              _mm256_mullo_epi32(e, _mm256_set1_epi32(208))), round), 8);
+        const __m256i b = _mm256_srai_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(c298, _mm256_mullo_epi32(d, _mm256_set1_epi32(516))), round), 8);
+        StoreRgb8Avx2(r, g, b, dst);
+    }
+
+    __attribute__((target("avx2")))
+    void YuyvToRgbAvx2(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        const __m128i pickY = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i pickU = _mm_setr_epi8(1, 1, 5, 5, 9, 9, 13, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i pickV = _mm_setr_epi8(3, 3, 7, 7, 11, 11, 15, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* row = src + static_cast<size_t>(y) * width * 2;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 2));
+                ConvertYuv8Avx2(_mm_shuffle_epi8(packed, pickY), _mm_shuffle_epi8(packed, pickU),
+                                _mm_shuffle_epi8(packed, pickV), out + x * 3);
+            }
+            YuyvRowScalar(row, out, x, width);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void Nv12ToRgbAvx2(const uint8_t* src, uint8_t* dst, int width, int height, int firstRow, int lastRow) {
+        const __m128i pickU = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i pickV = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+        const uint8_t* uvPlane = src + static_cast<size_t>(width) * height;
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* yRow = src + static_cast<size_t>(y) * width;
+            const uint8_t* uvRow = uvPlane + static_cast<size_t>(y / 2) * width;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const __m128i y8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(yRow + x));
+                const __m128i uv8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(uvRow + x));
+                ConvertYuv8Avx2(y8, _mm_shuffle_epi8(uv8, pickU), _mm_shuffle_epi8(uv8, pickV), out + x * 3);
+            }
+            Nv12RowScalar(yRow, uvRow, out, x, width);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void GreyToRgbAvx2(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        const int pixels = lastRow * width;
+        int x = firstRow * width;
+        for (; x + 8 <= pixels; x += 8) {
+            const __m256i grey = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x)));
+            StoreRgb8Avx2(grey, grey, grey, dst + static_cast<size_t>(x) * 3);
+        }
+        GreyRowScalar(src, dst, x, pixels);
+    }
+
+    const ConvertKernels kAvx2Kernels = {"avx2", YuyvToRgbAvx2, Nv12ToRgbAvx2, GreyToRgbAvx2};
+#endif
+
+#ifdef PIXEL_CONVERT_NEON
+    inline int16x8_t WidenSigned(uint8x8_t value, int16_t offset) {
+        return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(value)), vdupq_n_s16(offset));
+    }
+
+    // Products reach ~123k, so they are accumulated in int32 halves before narrowing with saturation
+    inline uint8x8_t Channel(int16x8_t c, int16x8_t a, int16_t ka, int16x8_t b, int16_t kb) {
+        int32x4_t lo = vmlal_n_s16(vmlal_n_s16(vmull_n_s16(vget_low_s16(c), 298), vget_low_s16(a), ka),
+                                   vget_low_s16(b), kb);
+        int32x4_t hi = vmlal_n_s16(vmlal_n_s16(vmull_n_s16(vget_high_s16(c), 298), vget_high_s16(a), ka),
+                                   vget_high_s16(b), kb);
+        lo = vshrq_n_s32(vaddq_s32(lo, vdupq_n_s32(128)), 8);
+        hi = vshrq_n_s32(vaddq_s32(hi, vdupq_n_s32(128)), 8);
+        return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    inline void ConvertYuv8Neon(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8, uint8_t* dst) {
+        const int16x8_t c = WidenSigned(y8, 16);
+        const int16x8_t d = WidenSigned(u8, 128);
+        const int16x8_t e = WidenSigned(v8, 128);
+        uint8x8x3_t rgb;
+        rgb.val[0] = Channel(c, e, 409, d, 0);
+        rgb.val[1] = Channel(c, d, -100, e, -208);
+        rgb.val[2] = Channel(c, d, 516, e, 0);
+        vst3_u8(dst, rgb);
+    }
+
+    // U0 V0 U1 V1 U2 V2 U3 V3 -> U0 U0 U1 U1 U2 U2 U3 U3 and the same for V
+    inline void SplitChroma(uint8x8_t uv, uint8x8_t& u, uint8x8_t& v) {
+        const uint8x8x2_t split = vuzp_u8(uv, uv);
+        u = vzip_u8(split.val[0], split.val[0]).val[0];
+        v = vzip_u8(split.val[1], split.val[1]).val[0];
+    }
+
+    void YuyvToRgbNeon(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* row = src + static_cast<size_t>(y) * width * 2;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const uint8x8x2_t packed = vld2_u8(row + x * 2);
+                uint8x8_t u, v;
+                SplitChroma(packed.val[1], u, v);
+                ConvertYuv8Neon(packed.val[0], u, v, out + x * 3);
+            }
+            YuyvRowScalar(row, out, x, width);
+        }
+    }
+
+    void Nv12ToRgbNeon(const uint8_t* src, uint8_t* dst, int width, int height, int firstRow, int lastRow) {
+        const uint8_t* uvPlane = src + static_cast<size_t>(width) * height;
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uint8_t* yRow = src + static_cast<size_t>(y) * width;
+            const uint8_t* uvRow = uvPlane + static_cast<size_t>(y / 2) * width;
+            uint8_t* out = dst + static_cast<size_t>(y) * width * 3;
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                uint8x8_t u, v;
+                SplitChroma(vld1_u8(uvRow + x), u, v);
+                ConvertYuv8Neon(vld1_u8(yRow + x), u, v, out + x * 3);
+            }
+            Nv12RowScalar(yRow, uvRow, out, x, width);
+        }
+    }
+
+    void GreyToRgbNeon(const uint8_t* src, uint8_t* dst, int width, int, int firstRow, int lastRow) {
+        const int pixels = lastRow * width;
+        int x = firstRow * width;
+        for (; x + 16 <= pixels; x += 16) {
+            const uint8x16_t grey = vld1q_u8(src + x);
+            vst3q_u8(dst + static_cast<size_t>(x) * 3, uint8x16x3_t{{grey, grey, grey}});
+        }
+        GreyRowScalar(src, dst, x, pixels);
+    }
+
+    const ConvertKernels kNeonKernels = {"neon", YuyvToRgbNeon, Nv12ToRgbNeon, GreyToRgbNeon};
+#endif
+
+}
+
+std::vector<const ConvertKernels*> GetSupportedConvertKernels() {
+    std::vector<const ConvertKernels*> kernels = {&kScalarKernels};
+#ifdef PIXEL_CONVERT_X86
+    __builtin_cpu_init();
+    kernels.push_back(&kSse2Kernels);
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&kAvx2Kernels);
+    }
+#elif defined(PIXEL_CONVERT_NEON)
+    kernels.push_back(&kNeonKernels);
+#endif
+    return kernels;
+}
+
+const ConvertKernels& GetConvertKernels() {
+    // Picked once at load time, the last supported entry is the widest vector unit
+    static const ConvertKernels& kernels = *GetSupportedConvertKernels().back();
+    return kernels;
+}
+
+const ConvertKernels& GetScalarConvertKernels() {
+    return kScalarKernels;
+}
@@ -1,9 +1,15 @@
 #include <napi.h>
 
+#include "addon_data.h"
 #include "imageproc.h"
 #include "capture.h"
 
+AddonData& GetAddonData(Napi::Env env) {
+    return *env.GetInstanceData<AddonData>();
+}
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    env.SetInstanceData(new AddonData());
     exports = Capture::Init(env, exports);
     return ImageProc::Init(env, exports);
 }
@@ -3,24 +3,263 @@ interface FrameData {
   width: number;
   height: number;
   dataSize: number;
+  /** Driver capture time on CLOCK_MONOTONIC in microseconds, dequeue time for drivers without monotonic stamps (linux only) */
+  timestampUs?: number;
+  /** Driver frame counter, gaps are frames the driver dropped (linux only) */
+  sequence?: number;
+  /** Milliseconds between the driver capturing the frame and native code processing it (linux only) */
+  ageMs?: number;
+  /** Milliseconds between the frame capture time and its pacing deadline (linux only) */
+  lateMs?: number;
+  /** Downscale factor against the capture resolution, each sample covers scale x scale pixels, 1 for native size (linux only) */
+  scale?: number;
+  /** Bytes per pixel: 3 for RGB, 1 for luma only (linux only) */
+  channels?: number;
+  /** Undecoded source of this frame, only with the rawFrames capture option (linux only) */
+  raw?: NativeRawFrame;
+}
+
+interface NativeRawFrame {
+  /** Driver bytes, e.g. a complete JPEG for MJPG. Holding on to it keeps a pool buffer out of the driver ring */
+  buffer: Buffer;
+  /** FourCC of the bytes, e.g. YUYV or MJPG */
+  format: string;
+  width: number;
+  height: number;
+  dataSize: number;
+}
+
+interface NativeImageOptions {
+  /** Bytes per pixel of the buffers: 3 for RGB (default), 1 for luma only */
+  channels?: 1 | 3;
+}
+
+interface NativeCompareOptions extends NativeImageOptions {
+  /**
+   * Stop comparing once this many pixels differ, the result is then at least this and not the exact count.
+   * 0 or undefined compares the whole frame
+   */
+  stopAfter?: number;
+  /** Row order: 'linear' (default) or 'interleaved', every 8th row first so large motion is found early */
+  scanOrder?: 'linear' | 'interleaved';
+  /**
+   * Also count changed pixels per tile of tileSize x tileSize pixels (1-255) in the same pass, the result is
+   * then a NativeTileDiff. Can't be combined with stopAfter
+   */
+  tileSize?: number;
+}
+
+interface NativeTileDiff {
+  /** Changed pixels of the whole frame, what compareRgbImages resolves to without tileSize */
+  diffPixels: number;
+  /** Changed pixels per tile, row-major with columns * rows entries, edge tiles are cut off by the frame */
+  tiles: Uint16Array;
+  columns: number;
+  rows: number;
+  tileSize: number;
+}
+
+interface SnapshotFrameData extends FrameData {
+  /** Milliseconds from the request until the full resolution frame was converted */
+  switchMs: number;
+  /** Milliseconds spent switching back to the detection mode */
+  restoreMs: number;
+}
+
+interface NativeCaptureOptions {
+  /** Number of driver buffers to request, default 4 (linux only) */
+  bufferCount?: number;
+  /** Drain all ready buffers on each wakeup and only process the newest one (linux only) */
+  latestFrameOnly?: boolean;
+  /** Smallest frame width motion detection still works with, picks the cheapest mode covering it (linux only) */
+  minWidth?: number;
+  /** Smallest frame height motion detection still works with, picks the cheapest mode covering it (linux only) */
+  minHeight?: number;
+  /** Detect on frames at 1/decodeScale of the capture size, full size only for snapshots (linux only) */
+  decodeScale?: 1 | 2 | 4 | 8;
+  /** Detect on a single luma channel: MJPEG decodes to grayscale, raw formats convert to luma only (linux only) */
+  grayscale?: boolean;
+  /** Detect on the DC coefficient of every 8x8 MJPEG luma block instead of decoding pixels (linux only) */
+  dctDetection?: boolean;
+  /** Threads converting raw frames in row bands, capture thread included, 0 or unset is one per core up to 4 (linux only) */
+  conversionThreads?: number;
+  /** Milliseconds without a buffer after which the camera counts as lost, default 2000 (linux only) */
+  stallTimeoutMs?: number;
+  /** Reopen a lost camera in place with exponential backoff, default true (linux only) */
+  reconnect?: boolean;
+  /** Capture into frame pool buffers (V4L2 USERPTR) so raw frames are lent out without copying, MMAP if the driver refuses (linux only) */
+  userPtr?: boolean;
+  /** Attach the raw source to every frame; with userPtr up to this many are lent out at once, the rest are copied, default 0 (linux only) */
+  rawFrames?: number;
+}
+
+interface NativeCaptureEvent {
+  /** lost, then retry after every failed attempt, then reconnected once frames flow again */
+  type: 'lost' | 'retry' | 'reconnected';
+  /** Device path at the time of the event */
+  device: string;
+  /** Reopen attempts so far, 0 for lost */
+  attempt: number;
+  /** Milliseconds since the camera was lost */
+  durationMs: number;
+  /** Why the camera counts as lost or why the attempt failed */
+  message?: string;
+}
+
+interface NativeCameraQuery extends NativeCaptureOptions {
+  /** Frame rate start() would be called with, used to pick the frame interval */
+  frameRate?: number;
+}
+
+interface NativeCaptureMode {
+  /** FourCC of the pixel format, e.g. YUYV or MJPG */
+  format: string;
+  width: number;
+  height: number;
+  /** Driver frame rate of the mode, missing when the driver doesn't enumerate intervals */
+  fps?: number;
+  /** True when the mode is applied with S_FMT instead of using the driver default */
+  negotiated: boolean;
+  /** Why this mode was picked */
+  reason: string;
 }
 
 interface NativeCameraInfo {
   name: string;
   path: string;
+  /** Mode start() uses for this camera with the given query (linux only) */
+  selectedMode?: NativeCaptureMode;
+}
+
+interface NativeFramePoolStats {
+  /** Acquisitions served from an idle frame of the same resolution and format */
+  hits: number;
+  /** Acquisitions that had to allocate */
+  misses: number;
+  /** Frames currently held by the capture thread or JS */
+  outstanding: number;
+  /** Maximum number of frames outstanding at once */
+  highWater: number;
+  /** Idle frames kept for reuse */
+  cached: number;
+}
+
+interface NativeCaptureStats {
+  /** Frames handed to the JS callback */
+  delivered: number;
+  /** Frames replaced by a newer one before JS picked them up */
+  overwritten: number;
+  /** Delivered frames that were older than one frame period when JS got them */
+  stale: number;
+  /** Frames the driver dropped before we could dequeue them, from gaps in the sequence numbers */
+  driverDrops: number;
+  /** Frames dequeued and given back unconverted on purpose, by pacing or latestFrameOnly */
+  skipped: number;
+  /** Frames flagged corrupt by the driver or that failed to decode */
+  discarded: number;
+  /** Raw frames handed out by lending the driver buffer and queueing a fresh pool buffer in its place */
+  rawLent: number;
+  /** Raw frames copied out of the driver buffer: loans used up, MMAP buffers or allocation failure */
+  rawCopied: number;
+  /** Times the watchdog reopened a lost camera */
+  reconnects: number;
+  /** Milliseconds the last reconnect took from losing the camera to getting it back */
+  lastReconnectMs: number;
+}
+
+interface NativeConversionStats {
+  /** Threads converting one frame, the capture thread included */
+  threads: number;
+  /** Frames split into row bands */
+  parallelFrames: number;
+  /** Frames converted on the capture thread alone, too small to be worth splitting */
+  serialFrames: number;
+  /** Wall time of the last converted frame */
+  lastFrameMs: number;
+  /** Time of every band of the last split frame */
+  lastBandMs: number[];
+  /** Average band time since capture started */
+  avgBandMs: number;
+  /** Slowest band since capture started */
+  maxBandMs: number;
+}
+
+interface NativeImageWorkerOptions {
+  /** Threads comparing and encoding images, 0 or undefined is one per core */
+  threads?: number;
+  /** CPUs the threads are pinned to, thread i to affinity[i % length] */
+  affinity?: number[];
+}
+
+interface NativeImageWorkerStats {
+  /** Threads comparing and encoding images */
+  threads: number;
+  /** Jobs waiting in all queues */
+  queued: number;
+  /** Jobs waiting in each thread's queue */
+  queueDepths: number[];
+  /** Jobs being executed right now */
+  running: number;
+  submitted: number;
+  completed: number;
+  /** Jobs a thread took from another thread's queue */
+  steals: number;
+}
+
+/**
+ * One camera with its own native capture thread, several sessions capture from different cameras at once (linux only)
+ */
+interface INativeCaptureSession {
+  /**
+   * Starts capturing, a running session is stopped first
+   * @param deviceName - Name or path of the video device to capture from
+   * @param frameRate - Desired frame rate for capture
+   * @param callback - Function called when new frames are available
+   * @param options - Optional capture tunables
+   * @param onEvent - Optional watchdog reports about a lost camera being reconnected
+   */
+  start(deviceName: string, frameRate: number, callback: (frameInfo: FrameData) => void, options?: NativeCaptureOptions, onEvent?: (event: NativeCaptureEvent) => void): void;
+
+  /**
+   * Stops capturing, pending snapshots are rejected
+   */
+  stop(): void;
+
+  /**
+   * Grabs one frame in the camera's largest mode and switches back to the detection mode
+   * @returns Promise with the full resolution RGB frame, or null when capture already runs at full resolution
+   */
+  captureSnapshot(): Promise<SnapshotFrameData | null>;
+
+  /**
+   * Frame delivery counters of this session
+   */
+  getCaptureStats(): NativeCaptureStats;
+
+  /**
+   * Row-parallel conversion counters of this session, null while stopped
+   */
+  getConversionStats(): NativeConversionStats | null;
 }
 
 interface INativeModule {
   // loaded by nodejs
   path: string;
 
+  /**
+   * Independent capture sessions, the module level start()/stop() drive a default one (linux only)
+   */
+  CaptureSession?: new () => INativeCaptureSession;
+
   /**
    * Starts video capture with callback
    * @param deviceName - Name of the video device to capture from
    * @param frameRate - Desired frame rate for capture
    * @param callback - Function called when new frames are available
+   * @param options - Optional capture tunables
+   * @param onEvent - Optional watchdog reports about a lost camera being reconnected (linux only)
    */
-  start(deviceName: string, frameRate: number, callback: (frameInfo: any) => void): void;
+  start(deviceName: string, frameRate: number, callback: (frameInfo: any) => void, options?: NativeCaptureOptions, onEvent?: (event: NativeCaptureEvent) => void): void;
 
   /**
    * Stops video capture
@@ -35,39 +274,113 @@ interface INativeModule {
 
   /**
    * Lists available camera devices on the system
+   * @param query - Optional capture options and frame rate to report the selected mode for
    * @returns Array of camera descriptors including display name and device path
    */
-  listAvailableCameras(): NativeCameraInfo[];
+  listAvailableCameras(query?: NativeCameraQuery): NativeCameraInfo[];
+
+  /**
+   * Frame buffer pool counters (linux only)
+   * @returns Hit/miss and high-water statistics of the native frame pool
+   */
+  getFramePoolStats?(): NativeFramePoolStats;
+
+  /**
+   * Frame delivery counters of the current capture session (linux only)
+   * @returns Delivered, overwritten and stale frame counts, plus driver drops kept apart from frames skipped on purpose
+   */
+  getCaptureStats?(): NativeCaptureStats;
+
+  /**
+   * Grabs one frame in the camera's largest mode and switches back to the detection mode (linux only)
+   * @returns Promise with the full resolution RGB frame, or null when capture already runs at full resolution
+   * @throws Error if capture is not running or the switch failed
+   */
+  captureSnapshot?(): Promise<SnapshotFrameData | null>;
+
+  /**
+   * Row-parallel conversion counters of the current capture session (linux only)
+   * @returns Frame counts and per-band timings, or null when capture was never started
+   */
+  getConversionStats?(): NativeConversionStats | null;
 
   // High-Performance RGB Functions
   /**
-   * Convert RGB image buffer to JPEG buffer asynchronously
+   * Convert RGB image buffer to JPEG buffer asynchronously. The input is read in place, don't modify it until
+   * the promise settles
    * @param rgbBuffer - Buffer containing RGB image data
    * @param width - Image width in pixels
    * @param height - Image height in pixels
+   * @param options - Optional buffer layout, single channel buffers produce a grayscale JPEG
    * @returns Promise<Buffer> containing JPEG data
    * @throws Error if conversion fails
    */
-  convertRgbToJpeg(rgbBuffer: Buffer, width: number, height: number): Promise<Buffer>;
+  convertRgbToJpeg(rgbBuffer: Buffer, width: number, height: number, options?: NativeImageOptions): Promise<Buffer>;
 
   /**
-   * Compare two RGB images and count different pixels asynchronously
+   * Compare two RGB images and count different pixels asynchronously. Both buffers are read in place, don't
+   * modify them until the promise settles
    * @param rgbBuffer1 - Buffer containing first RGB image data
    * @param rgbBuffer2 - Buffer containing second RGB image data
    * @param width - Image width in pixels
    * @param height - Image height in pixels
    * @param threshold - Threshold for pixel difference (0-1, similar to pixelmatch)
-   * @returns Promise<number> containing the number of different pixels
+   * @param options - Optional buffer layout of both images, early exit and tile grid
+   * @returns Promise<number> containing the number of different pixels, or the tile grid with tileSize
    * @throws Error if comparison fails
    */
-  compareRgbImages(rgbBuffer1: Buffer, rgbBuffer2: Buffer, width: number, height: number, threshold: number): Promise<number>;
+  compareRgbImages(rgbBuffer1: Buffer, rgbBuffer2: Buffer, width: number, height: number, threshold: number, options: NativeCompareOptions & {tileSize: number}): Promise<NativeTileDiff>;
+  compareRgbImages(rgbBuffer1: Buffer, rgbBuffer2: Buffer, width: number, height: number, threshold: number, options?: NativeCompareOptions): Promise<number>;
+
+  /**
+   * Compare two RGB images in one pass and count pixels per difference instead of against one threshold.
+   * Bin d holds the pixels whose average channel difference is exactly d (0-255), so compareRgbImages with
+   * threshold t counts the sum of the bins above Math.floor(t * 255). Buffers are read in place like there
+   * @param rgbBuffer1 - Buffer containing first RGB image data
+   * @param rgbBuffer2 - Buffer containing second RGB image data
+   * @param width - Image width in pixels
+   * @param height - Image height in pixels
+   * @param options - Optional buffer layout of both images
+   * @returns Promise<Uint32Array> of 256 bins
+   * @throws Error if comparison fails
+   */
+  compareRgbImagesHistogram?(rgbBuffer1: Buffer, rgbBuffer2: Buffer, width: number, height: number, options?: NativeImageOptions): Promise<Uint32Array>;
+
+  /**
+   * Sizes and pins the threads running convertRgbToJpeg and compareRgbImages
+   * @param options - Thread count and CPU affinity
+   * @returns Number of threads started
+   * @throws Error if an image job already started the threads
+   */
+  configureImageWorkers?(options: NativeImageWorkerOptions): number;
+
+  /**
+   * Queue and work-stealing counters of the image threads, all zero until the first job starts them
+   * @returns Queue depths, job counts and steals
+   */
+  getImageWorkerStats?(): NativeImageWorkerStats;
 }
 
 export const Native = 'Native';
 
 export type {
   INativeModule,
+  INativeCaptureSession,
   FrameData,
+  SnapshotFrameData,
+  NativeRawFrame,
   NativeCameraInfo,
+  NativeCaptureOptions,
+  NativeCaptureEvent,
+  NativeImageOptions,
+  NativeCompareOptions,
+  NativeTileDiff,
+  NativeCameraQuery,
+  NativeCaptureMode,
+  NativeFramePoolStats,
+  NativeCaptureStats,
+  NativeConversionStats,
+  NativeImageWorkerOptions,
+  NativeImageWorkerStats,
 };
 
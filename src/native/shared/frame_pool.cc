@@ -0,0 +1,152 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+    uint8_t* AllocateAligned(size_t size, size_t alignment) {
+        // Round up so SIMD loops may touch the tail of the last vector without leaving the allocation
+        size_t rounded = (size + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+        void* ptr = _aligned_malloc(rounded, alignment);
+#else
+        void* ptr = std::aligned_alloc(alignment, rounded);
+#endif
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<uint8_t*>(ptr);
+    }
+
+    void FreeAligned(uint8_t* ptr) {
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+}
+
+FramePool::FramePool(size_t maxCachedFrames) : maxCachedFrames_(maxCachedFrames) {}
+
+FramePool::~FramePool() {
+    for (auto& entry : idle_) {
+        for (FrameData* frame : entry.second) {
+            Destroy(frame);
+        }
+    }
+}
+
+FramePool& FramePool::Instance() {
+    static FramePool* pool = new FramePool(8);
+    return *pool;
+}
+
+void FramePool::Destroy(FrameData* frame) {
+    FreeAligned(frame->data);
+    delete frame;
+}
+
+FrameData* FramePool::Acquire(int width, int height, uint32_t format, size_t size, bool raw) {
+    const Key key{width, height, format, raw};
+    FrameData* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = idle_.find(key);
+        if (it != idle_.end() && !it->second.empty()) {
+            frame = it->second.back();
+            it->second.pop_back();
+            --cached_;
+        }
+        if (frame != nullptr && frame->capacity >= size) {
+            ++stats_.hits;
+        } else {
+            ++stats_.misses;
+        }
+        ++stats_.outstanding;
+        stats_.highWater = std::max(stats_.highWater, stats_.outstanding);
+    }
+
+    if (frame == nullptr) {
+        frame = new FrameData();
+        frame->data = nullptr;
+        frame->capacity = 0;
+    }
+    if (frame->capacity < size) {
+        FreeAligned(frame->data);
+        frame->data = nullptr;
+        frame->capacity = 0;
+        frame->data = AllocateAligned(size, raw ? kRawAlignment : kAlignment);
+        frame->capacity = size;
+    }
+
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+    frame->dataSize = size;
+    frame->timestampUs = 0;
+    frame->sequence = 0;
+    frame->ageMs = 0;
+    frame->lateMs = 0;
+    frame->scale = 1;
+    frame->channels = 3;
+    frame->raw = raw;
+    frame->rawFrame = nullptr;
+    frame->poolKey = {width, height, format, raw};
+    return frame;
+}
+
+void FramePool::Release(FrameData* frame) {
+    if (frame == nullptr) {
+        return;
+    }
+    if (frame->rawFrame != nullptr) {
+        Release(frame->rawFrame);
+        frame->rawFrame = nullptr;
+    }
+    if (frame->rawLoans) {
+        frame->rawLoans->fetch_add(1);
+        frame->rawLoans.reset();
+    }
+
+    const Key key{frame->poolKey.width, frame->poolKey.height, frame->poolKey.format, frame->poolKey.raw};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --stats_.outstanding;
+        if (cached_ < maxCachedFrames_ || EvictOtherThan(key)) {
+            idle_[key].push_back(frame);
+            ++cached_;
+            return;
+        }
+    }
+    Destroy(frame);
+}
+
+bool FramePool::EvictOtherThan(const Key& key) {
+    // Frames of a resolution we no longer capture shouldn't keep the current one out of the cache
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+        if (it->first == key || it->second.empty()) {
+            continue;
+        }
+        Destroy(it->second.back());
+        it->second.pop_back();
+        if (it->second.empty()) {
+            idle_.erase(it);
+        }
+        --cached_;
+        return true;
+    }
+    return false;
+}
+
+FramePoolStats FramePool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FramePoolStats stats = stats_;
+    stats.cached = cached_;
+    return stats;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <napi.h>
+
+namespace Capture { struct InstanceData; }
+namespace ImageProc { struct InstanceData; }
+
+// Addon state per environment, the main thread and every worker_thread that loads the addon get their own.
+// Each module creates and frees its part in its Init
+struct AddonData {
+    Capture::InstanceData* capture = nullptr;
+    ImageProc::InstanceData* imageProc = nullptr;
+};
+
+// Set up by the module Init before any module initialises
+AddonData& GetAddonData(Napi::Env env);
@@ -1,15 +1,46 @@
 #pragma once
 
 #include <napi.h>
-#include <vector>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 
-// Common frame data structure
+// Common frame data structure, allocated and recycled by FramePool
 struct FrameData {
-    std::vector<uint8_t> buffer;
+    // 64-byte aligned, uninitialised storage of `capacity` bytes, `dataSize` of them are valid
+    uint8_t* data;
+    size_t capacity;
     int width;
     int height;
     size_t dataSize;
+    // V4L2 fourcc of the source frame
+    uint32_t format;
+    // Capture time on CLOCK_MONOTONIC in microseconds
+    int64_t timestampUs;
+    // Driver frame counter (v4l2_buffer.sequence), gaps are frames the driver dropped
+    uint32_t sequence;
+    // Milliseconds between the driver capturing the frame and us starting to process it
+    double ageMs;
+    // How far after its pacing deadline the frame was captured, negative if slightly early
+    double lateMs;
+    // Downscale factor against the capture resolution, 1 for native size
+    int scale;
+    // Bytes per pixel: 3 for RGB, 1 for luma only
+    int channels;
+    // Undecoded driver bytes in `format` instead of converted pixels, storage is page aligned
+    bool raw;
+    // Raw source of this frame handed off along with it, released together unless JS took it over
+    FrameData* rawFrame;
+    // Set on a driver ring buffer lent out without copying, the loan goes back to the session on release
+    std::shared_ptr<std::atomic<int>> rawLoans;
+    // Owned by FramePool, identifies the free list the frame returns to
+    struct {
+        int width;
+        int height;
+        uint32_t format;
+        bool raw;
+    } poolKey;
 };
 
 // Common image processing functions
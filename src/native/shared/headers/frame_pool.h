@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "common.h"
+
+struct FramePoolStats {
+    uint64_t hits;
+    uint64_t misses;
+    size_t outstanding;
+    size_t highWater;
+    size_t cached;
+};
+
+// Recycles FrameData storage keyed by resolution and pixel format.
+// Storage is 64-byte aligned and never zero-initialised, converters overwrite it anyway.
+// At most maxCachedFrames idle frames are kept, everything above that is freed.
+class FramePool {
+public:
+    static constexpr size_t kAlignment = 64;
+    // Raw frames double as V4L2 USERPTR buffers, which drivers pin page by page
+    static constexpr size_t kRawAlignment = 4096;
+
+    explicit FramePool(size_t maxCachedFrames);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Process-wide pool shared by all capture sessions, never destroyed so late JS finalizers stay valid
+    static FramePool& Instance();
+
+    // Returns a frame with at least `size` bytes of storage, dataSize is set to `size`.
+    // Raw frames hold undecoded driver bytes and have free lists of their own
+    FrameData* Acquire(int width, int height, uint32_t format, size_t size, bool raw = false);
+    void Release(FrameData* frame);
+    FramePoolStats GetStats() const;
+
+private:
+    using Key = std::tuple<int, int, uint32_t, bool>;
+
+    static void Destroy(FrameData* frame);
+    bool EvictOtherThan(const Key& key);
+
+    mutable std::mutex mutex_;
+    std::map<Key, std::vector<FrameData*>> idle_;
+    size_t maxCachedFrames_;
+    size_t cached_ = 0;
+    FramePoolStats stats_ = {};
+};
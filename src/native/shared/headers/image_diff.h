@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Counts pixels of `a` that differ from `b` by more than `threshold` (0..255): the absolute difference
+// for luma, the truncated mean of the three channel differences for RGB
+using DiffKernel = size_t (*)(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold);
+
+// Pixel diff kernels, free of Napi so they can be benchmarked standalone. Every implementation returns
+// exactly what the scalar one does
+struct DiffKernels {
+    const char* name;
+    DiffKernel countLuma;
+    DiffKernel countRgb;
+};
+
+// Best kernels for the running CPU, picked once on first use
+const DiffKernels& GetDiffKernels();
+
+// Every implementation the running CPU can execute, scalar first and widest last
+std::vector<const DiffKernels*> GetSupportedDiffKernels();
+
+// Reference implementation, also the fallback on CPUs without a vector path
+const DiffKernels& GetScalarDiffKernels();
+
+constexpr size_t kDiffHistogramBins = 256;
+
+// Fills `bins` (kDiffHistogramBins entries) with how many pixels differ by exactly each value, the same
+// difference the count kernels compare, so one pass answers every threshold
+void DiffHistogramLuma(const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t* bins);
+void DiffHistogramRgb(const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t* bins);
+
+// What the count kernels return for `threshold`: the sum of the bins above it
+size_t CountFromDiffHistogram(const uint32_t* bins, int threshold);
+
+// Largest tile whose count still fits a uint16_t
+constexpr int kMaxDiffTileSize = 255;
+
+// Counts changed pixels per tileSize x tileSize tile (1..kMaxDiffTileSize) into `tiles`, row-major with
+// ceil(width / tileSize) columns, tiles on the right and bottom edge are cut off by the frame. Returns the
+// total, the same as `count` over the whole frame
+size_t CountDiffTiles(DiffKernel count, const uint8_t* a, const uint8_t* b, int width, int height, int channels,
+                      int threshold, int tileSize, uint16_t* tiles);
@@ -1,17 +1,14 @@
 #pragma once
 
 #include <napi.h>
-#include <vector>
-
-struct SimpleImage {
-    int width;
-    int height;
-    int components;
-    std::vector<unsigned char> data;
-};
 
 namespace ImageProc {
     Napi::Value ConvertRgbToJpeg(const Napi::CallbackInfo& info);
     Napi::Value CompareRgbImages(const Napi::CallbackInfo& info);
+    // 256 bins of per-pixel differences in one pass, the count for threshold t is the sum of the bins above t * 255
+    Napi::Value CompareRgbImagesHistogram(const Napi::CallbackInfo& info);
+    // Sizes and pins the image worker threads, only before the first job starts them. Returns the thread count
+    Napi::Value ConfigureImageWorkers(const Napi::CallbackInfo& info);
+    Napi::Value GetImageWorkerStats(const Napi::CallbackInfo& info);
     Napi::Object Init(Napi::Env env, Napi::Object exports);
 }
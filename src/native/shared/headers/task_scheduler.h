@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct TaskSchedulerOptions {
+    // 0 picks one thread per core, at least 2 and at most kMaxAutoThreads
+    size_t threads = 0;
+    // CPUs the threads are pinned to, thread i to affinity[i % size]. Empty leaves placement to the OS
+    std::vector<int> affinity;
+};
+
+struct TaskSchedulerStats {
+    size_t threads = 0;
+    // Tasks waiting in all deques, and the depth of each thread's deque
+    size_t queued = 0;
+    std::vector<size_t> queueDepths;
+    // Tasks being executed right now
+    size_t running = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    // Tasks a thread took from another thread's deque
+    uint64_t steals = 0;
+};
+
+// Work-stealing scheduler owned by the addon, so heavy image work doesn't compete with fs and DNS requests
+// in libuv's threadpool. Every thread has its own deque: it runs its newest task first and, once empty,
+// steals the oldest task of the next busy thread. Tasks submitted from outside are dealt round-robin
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    static constexpr size_t kMaxAutoThreads = 8;
+
+    explicit TaskScheduler(const TaskSchedulerOptions& options);
+    // Runs every task still queued, then joins the threads
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // The task must not throw. Safe from any thread, a scheduler thread pushes onto its own deque
+    void Submit(Task task);
+    TaskSchedulerStats GetStats() const;
+    size_t ThreadCount() const { return workers_.size(); }
+
+private:
+    struct Worker {
+        mutable std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void WorkerLoop(size_t index);
+    bool TakeTask(size_t index, Task& task);
+    void PinThread(std::thread& thread, int cpu);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> nextWorker_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> running_{0};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> steals_{0};
+    bool stopping_ = false;
+};
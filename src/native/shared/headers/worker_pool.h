@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded set of native threads running the indices of one job in parallel.
+// The thread calling Run() works on the job as well, so N threads give N + 1 lanes
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t ThreadCount() const { return threads_.size(); }
+
+    // Calls task(index) once for every index in [0, count) and returns when all calls finished.
+    // The task must not throw. One job runs at a time, concurrent callers wait for the previous one
+    void Run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    void WorkerLoop();
+    // Claims and runs indices of the current job until none are left
+    void Work();
+
+    std::vector<std::thread> threads_;
+    std::mutex runMutex_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    // Current job, only replaced while no worker is busy
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    size_t next_ = 0;
+    uint64_t generation_ = 0;
+    size_t busy_ = 0;
+    bool stopping_ = false;
+};
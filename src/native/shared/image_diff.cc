@@ -0,0 +1,442 @@
+#include "image_diff.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)) || defined(_M_X64)
+#include <immintrin.h>
+#define IMAGE_DIFF_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC emits AVX2 intrinsics without a per-function target
+#define IMAGE_DIFF_AVX2
+#else
+#define IMAGE_DIFF_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IMAGE_DIFF_NEON 1
+#endif
+
+namespace {
+    size_t CountLumaScalar(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels = 0;
+        for (size_t i = 0; i < pixels; ++i) {
+            if (std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])) > threshold) {
+                ++diffPixels;
+            }
+        }
+        return diffPixels;
+    }
+
+    size_t CountRgbScalar(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels = 0;
+        for (size_t i = 0; i < pixels; ++i) {
+            const size_t pixelOffset = i * 3;
+
+            const int rDiff = std::abs(static_cast<int>(a[pixelOffset]) - static_cast<int>(b[pixelOffset]));
+            const int gDiff = std::abs(static_cast<int>(a[pixelOffset + 1]) - static_cast<int>(b[pixelOffset + 1]));
+            const int bDiff = std::abs(static_cast<int>(a[pixelOffset + 2]) - static_cast<int>(b[pixelOffset + 2]));
+
+            const int avgDiff = (rDiff + gDiff + bDiff) / 3;
+
+            if (avgDiff > threshold) {
+                ++diffPixels;
+            }
+        }
+        return diffPixels;
+    }
+
+    const DiffKernels kScalarKernels = {"scalar", CountLumaScalar, CountRgbScalar};
+
+    // Four partial tables, so runs of equal differences, the usual case on a still scene, don't wait on the
+    // store of the previous increment to the same bin
+    template <typename Difference>
+    void AccumulateHistogram(size_t pixels, uint32_t* bins, Difference difference) {
+        uint32_t partial[4][kDiffHistogramBins] = {};
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            ++partial[0][difference(i)];
+            ++partial[1][difference(i + 1)];
+            ++partial[2][difference(i + 2)];
+            ++partial[3][difference(i + 3)];
+        }
+        for (; i < pixels; ++i) {
+            ++partial[0][difference(i)];
+        }
+        for (size_t bin = 0; bin < kDiffHistogramBins; ++bin) {
+            bins[bin] = partial[0][bin] + partial[1][bin] + partial[2][bin] + partial[3][bin];
+        }
+    }
+
+    // Differences are 0..255, so thresholds outside 0..254 decide every pixel the same way and the vector
+    // kernels only deal with thresholds that fit a byte
+    bool TrivialThreshold(size_t pixels, int threshold, size_t& diffPixels) {
+        if (threshold < 0) {
+            diffPixels = pixels;
+            return true;
+        }
+        if (threshold >= 255) {
+            diffPixels = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // (r + g + b) / 3 > t holds exactly when r + g + b >= 3 * (t + 1), so the divide becomes a compare
+    inline int RgbSumThreshold(int threshold) {
+        return 3 * threshold + 2;
+    }
+
+    // Vector RGB kernels sum the byte differences at every offset p, p + 1 and p + 2 and only keep the sums
+    // starting on a pixel. Lanes of 16-bit sums are flushed before the counters could wrap
+    constexpr size_t kFlushBlocks = 4096;
+
+#ifdef IMAGE_DIFF_X86
+    // Masks the 16-bit byte sums that start a pixel, every third lane. Vector k of a block covers the lanes
+    // from k * 8 (SSE2) or k * 16 (AVX2), both line up with byte offsets in the block
+    struct PixelStartLanes {
+        alignas(32) uint16_t lanes[96];
+
+        constexpr PixelStartLanes() : lanes() {
+            for (int i = 0; i < 96; ++i) {
+                lanes[i] = i % 3 == 0 ? 0xFFFF : 0;
+            }
+        }
+    };
+
+    constexpr PixelStartLanes kPixelStarts;
+
+    // Bytes the loads at p + 2 read past an RGB block, the copy the last block runs on is padded by this
+    constexpr size_t kRgbBlockReadAhead = 2;
+
+    inline __m128i AbsDiffSse2(__m128i a, __m128i b) {
+        return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    }
+
+    inline size_t SumEpi64(__m128i value) {
+        alignas(16) uint64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), value);
+        return static_cast<size_t>(lanes[0] + lanes[1]);
+    }
+
+    // Adds up 16-bit counters through 32-bit lanes
+    inline size_t SumEpu16(__m128i value) {
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_madd_epi16(value, _mm_set1_epi16(1)));
+        return static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    size_t CountLumaSse2(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i total = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            const __m128i diff = AbsDiffSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+            // Saturating subtract leaves a non-zero byte exactly where the difference exceeds the threshold
+            const __m128i hits = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, limit), zero), one);
+            total = _mm_add_epi64(total, _mm_sad_epu8(hits, zero));
+        }
+        return SumEpi64(total) + CountLumaScalar(a + i, b + i, pixels - i, threshold);
+    }
+
+    // A 48-byte block is 16 pixels, 16-bit lane j of the k-th half covers byte offset 8k + j
+    inline __m128i CountRgbBlockSse2(const uint8_t* blockA, const uint8_t* blockB, __m128i limit, __m128i counts) {
+        const __m128i zero = _mm_setzero_si128();
+        for (int step = 0; step < 3; ++step) {
+            __m128i lo = zero;
+            __m128i hi = zero;
+            for (int offset = 0; offset < 3; ++offset) {
+                const __m128i diff = AbsDiffSse2(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockA + step * 16 + offset)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockB + step * 16 + offset)));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(diff, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(diff, zero));
+            }
+            const __m128i loStarts = _mm_load_si128(reinterpret_cast<const __m128i*>(kPixelStarts.lanes + step * 16));
+            const __m128i hiStarts = _mm_load_si128(reinterpret_cast<const __m128i*>(kPixelStarts.lanes + step * 16 + 8));
+            // Masks are -1, subtracting them counts up
+            counts = _mm_sub_epi16(counts, _mm_and_si128(_mm_cmpgt_epi16(lo, limit), loStarts));
+            counts = _mm_sub_epi16(counts, _mm_and_si128(_mm_cmpgt_epi16(hi, limit), hiStarts));
+        }
+        return counts;
+    }
+
+    size_t CountRgbSse2(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        const __m128i limit = _mm_set1_epi16(static_cast<short>(RgbSumThreshold(threshold)));
+        __m128i counts = _mm_setzero_si128();
+        diffPixels = 0;
+        size_t blocks = 0;
+        size_t i = 0;
+        // The loads at p + 2 read two bytes into the next block
+        for (; i + 17 <= pixels; i += 16) {
+            counts = CountRgbBlockSse2(a + i * 3, b + i * 3, limit, counts);
+            if (++blocks == kFlushBlocks) {
+                diffPixels += SumEpu16(counts);
+                counts = _mm_setzero_si128();
+                blocks = 0;
+            }
+        }
+        // A last whole block runs on a padded copy, so row segments as short as 16 pixels stay vectorized
+        if (i + 16 <= pixels) {
+            uint8_t lastA[48 + kRgbBlockReadAhead] = {};
+            uint8_t lastB[48 + kRgbBlockReadAhead] = {};
+            std::memcpy(lastA, a + i * 3, 48);
+            std::memcpy(lastB, b + i * 3, 48);
+            counts = CountRgbBlockSse2(lastA, lastB, limit, counts);
+            i += 16;
+        }
+        return diffPixels + SumEpu16(counts) + CountRgbScalar(a + i * 3, b + i * 3, pixels - i, threshold);
+    }
+
+    const DiffKernels kSse2Kernels = {"sse2", CountLumaSse2, CountRgbSse2};
+
+    IMAGE_DIFF_AVX2
+    size_t CountLumaAvx2(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold));
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi8(1);
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= pixels; i += 32) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+            const __m256i hits = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(diff, limit), zero), one);
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(hits, zero));
+        }
+        const __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+        diffPixels = SumEpi64(halves);
+        // Legacy SSE code after dirty upper halves stalls on every call, which tile sized calls pay per segment
+        _mm256_zeroupper();
+        return diffPixels + CountLumaSse2(a + i, b + i, pixels - i, threshold);
+    }
+
+    IMAGE_DIFF_AVX2
+    inline size_t SumEpu16Avx2(__m256i value) {
+        const __m256i pairs = _mm256_madd_epi16(value, _mm256_set1_epi16(1));
+        return SumEpu16(_mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1)));
+    }
+
+    // A 96-byte block is 32 pixels, 16-bit lane j of the k-th sixteenth covers byte offset 16k + j
+    IMAGE_DIFF_AVX2
+    inline __m256i CountRgbBlockAvx2(const uint8_t* blockA, const uint8_t* blockB, __m256i limit, __m256i counts) {
+        for (int step = 0; step < 3; ++step) {
+            __m256i lo = _mm256_setzero_si256();
+            __m256i hi = _mm256_setzero_si256();
+            for (int offset = 0; offset < 3; ++offset) {
+                const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockA + step * 32 + offset));
+                const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockB + step * 32 + offset));
+                const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+                // Widening per 128-bit half keeps the lanes in memory order
+                lo = _mm256_add_epi16(lo, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(diff)));
+                hi = _mm256_add_epi16(hi, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(diff, 1)));
+            }
+            const __m256i loStarts = _mm256_load_si256(reinterpret_cast<const __m256i*>(kPixelStarts.lanes + step * 32));
+            const __m256i hiStarts = _mm256_load_si256(reinterpret_cast<const __m256i*>(kPixelStarts.lanes + step * 32 + 16));
+            counts = _mm256_sub_epi16(counts, _mm256_and_si256(_mm256_cmpgt_epi16(lo, limit), loStarts));
+            counts = _mm256_sub_epi16(counts, _mm256_and_si256(_mm256_cmpgt_epi16(hi, limit), hiStarts));
+        }
+        return counts;
+    }
+
+    IMAGE_DIFF_AVX2
+    size_t CountRgbAvx2(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        const __m256i limit = _mm256_set1_epi16(static_cast<short>(RgbSumThreshold(threshold)));
+        __m256i counts = _mm256_setzero_si256();
+        diffPixels = 0;
+        size_t blocks = 0;
+        size_t i = 0;
+        // The loads at p + 2 read two bytes into the next block
+        for (; i + 33 <= pixels; i += 32) {
+            counts = CountRgbBlockAvx2(a + i * 3, b + i * 3, limit, counts);
+            if (++blocks == kFlushBlocks) {
+                diffPixels += SumEpu16Avx2(counts);
+                counts = _mm256_setzero_si256();
+                blocks = 0;
+            }
+        }
+        if (i + 32 <= pixels) {
+            uint8_t lastA[96 + kRgbBlockReadAhead] = {};
+            uint8_t lastB[96 + kRgbBlockReadAhead] = {};
+            std::memcpy(lastA, a + i * 3, 96);
+            std::memcpy(lastB, b + i * 3, 96);
+            counts = CountRgbBlockAvx2(lastA, lastB, limit, counts);
+            i += 32;
+        }
+        diffPixels += SumEpu16Avx2(counts);
+        _mm256_zeroupper();
+        // Under 32 pixels left, SSE2 still takes a block of 16
+        return diffPixels + CountRgbSse2(a + i * 3, b + i * 3, pixels - i, threshold);
+    }
+
+    const DiffKernels kAvx2Kernels = {"avx2", CountLumaAvx2, CountRgbAvx2};
+
+    bool HasAvx2() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        // The OS has to save the YMM registers too
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+#ifdef IMAGE_DIFF_NEON
+    inline size_t SumU32(uint32x4_t value) {
+        uint32_t lanes[4];
+        vst1q_u32(lanes, value);
+        return static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    size_t CountLumaNeon(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        const uint8x16_t limit = vdupq_n_u8(static_cast<uint8_t>(threshold));
+        const uint8x16_t one = vdupq_n_u8(1);
+        uint32x4_t total = vdupq_n_u32(0);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            const uint8x16_t hits = vandq_u8(vcgtq_u8(diff, limit), one);
+            total = vpadalq_u16(total, vpaddlq_u8(hits));
+        }
+        return SumU32(total) + CountLumaScalar(a + i, b + i, pixels - i, threshold);
+    }
+
+    size_t CountRgbNeon(const uint8_t* a, const uint8_t* b, size_t pixels, int threshold) {
+        size_t diffPixels;
+        if (TrivialThreshold(pixels, threshold, diffPixels)) {
+            return diffPixels;
+        }
+
+        // vld3 splits the channels, so no pixel start masks are needed here
+        const uint16x8_t limit = vdupq_n_u16(static_cast<uint16_t>(RgbSumThreshold(threshold)));
+        uint32x4_t total = vdupq_n_u32(0);
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            const uint8x16x3_t pa = vld3q_u8(a + i * 3);
+            const uint8x16x3_t pb = vld3q_u8(b + i * 3);
+            const uint8x16_t r = vabdq_u8(pa.val[0], pb.val[0]);
+            const uint8x16_t g = vabdq_u8(pa.val[1], pb.val[1]);
+            const uint8x16_t bl = vabdq_u8(pa.val[2], pb.val[2]);
+            const uint16x8_t lo = vaddw_u8(vaddl_u8(vget_low_u8(r), vget_low_u8(g)), vget_low_u8(bl));
+            const uint16x8_t hi = vaddw_u8(vaddl_u8(vget_high_u8(r), vget_high_u8(g)), vget_high_u8(bl));
+            total = vpadalq_u16(total, vshrq_n_u16(vcgtq_u16(lo, limit), 15));
+            total = vpadalq_u16(total, vshrq_n_u16(vcgtq_u16(hi, limit), 15));
+        }
+        return SumU32(total) + CountRgbScalar(a + i * 3, b + i * 3, pixels - i, threshold);
+    }
+
+    const DiffKernels kNeonKernels = {"neon", CountLumaNeon, CountRgbNeon};
+#endif
+
+}
+
+std::vector<const DiffKernels*> GetSupportedDiffKernels() {
+    std::vector<const DiffKernels*> kernels = {&kScalarKernels};
+#ifdef IMAGE_DIFF_X86
+    kernels.push_back(&kSse2Kernels);
+    if (HasAvx2()) {
+        kernels.push_back(&kAvx2Kernels);
+    }
+#elif defined(IMAGE_DIFF_NEON)
+    kernels.push_back(&kNeonKernels);
+#endif
+    return kernels;
+}
+
+const DiffKernels& GetDiffKernels() {
+    // Picked once at load time, the last supported entry is the widest vector unit
+    static const DiffKernels& kernels = *GetSupportedDiffKernels().back();
+    return kernels;
+}
+
+const DiffKernels& GetScalarDiffKernels() {
+    return kScalarKernels;
+}
+
+void DiffHistogramLuma(const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t* bins) {
+    AccumulateHistogram(pixels, bins, [a, b](size_t i) {
+        return std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    });
+}
+
+void DiffHistogramRgb(const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t* bins) {
+    AccumulateHistogram(pixels, bins, [a, b](size_t i) {
+        const size_t pixelOffset = i * 3;
+        const int rDiff = std::abs(static_cast<int>(a[pixelOffset]) - static_cast<int>(b[pixelOffset]));
+        const int gDiff = std::abs(static_cast<int>(a[pixelOffset + 1]) - static_cast<int>(b[pixelOffset + 1]));
+        const int bDiff = std::abs(static_cast<int>(a[pixelOffset + 2]) - static_cast<int>(b[pixelOffset + 2]));
+        return (rDiff + gDiff + bDiff) / 3;
+    });
+}
+
+size_t CountFromDiffHistogram(const uint32_t* bins, int threshold) {
+    size_t diffPixels = 0;
+    for (int bin = std::max(threshold + 1, 0); bin < static_cast<int>(kDiffHistogramBins); ++bin) {
+        diffPixels += bins[bin];
+    }
+    return diffPixels;
+}
+
+size_t CountDiffTiles(DiffKernel count, const uint8_t* a, const uint8_t* b, int width, int height, int channels,
+                      int threshold, int tileSize, uint16_t* tiles) {
+    const int columns = (width + tileSize - 1) / tileSize;
+    const int rows = (height + tileSize - 1) / tileSize;
+    std::fill(tiles, tiles + static_cast<size_t>(columns) * rows, 0);
+
+    // Row segments one tile wide, so the frame is still read once, top to bottom
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    size_t diffPixels = 0;
+    for (int y = 0; y < height; ++y) {
+        const size_t rowOffset = static_cast<size_t>(y) * rowBytes;
+        uint16_t* tileRow = tiles + static_cast<size_t>(y / tileSize) * columns;
+        for (int column = 0; column < columns; ++column) {
+            const int x = column * tileSize;
+            const size_t offset = rowOffset + static_cast<size_t>(x) * channels;
+            const size_t changed = count(a + offset, b + offset, std::min(tileSize, width - x), threshold);
+            tileRow[column] = static_cast<uint16_t>(tileRow[column] + changed);
+            diffPixels += changed;
+        }
+    }
+    return diffPixels;
+}
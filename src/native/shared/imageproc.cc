@@ -1,14 +1,20 @@
 #include "imageproc.h"
 
+#include "addon_data.h"
+#include "image_diff.h"
+#include "task_scheduler.h"
 #include "toojpeg.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace {
-    // Global context for JPEG writing
-    std::vector<unsigned char>* g_jpegContext = nullptr;
+    // Context for JPEG writing, per thread since encodes run in parallel on the scheduler
+    thread_local std::vector<unsigned char>* g_jpegContext = nullptr;
 
     // C-style callback for TooJPEG
     void jpegWriteCallback(unsigned char byte) {
@@ -17,9 +23,11 @@ namespace {
         }
     }
 
-    // JPEG encoder using TooJPEG
-    std::vector<unsigned char> EncodeJPEG(const SimpleImage& img) {
+    // JPEG encoder using TooJPEG, reads the pixels in place
+    std::vector<unsigned char> EncodeJPEG(const unsigned char* pixels, int width, int height, int components) {
         std::vector<unsigned char> jpegData;
+        // Quality 85 frames rarely exceed a byte per pixel, so the callback seldom has to grow the vector
+        jpegData.reserve(static_cast<size_t>(width) * static_cast<size_t>(height));
 
         // Set global context for callback
         g_jpegContext = &jpegData;
@@ -27,10 +35,10 @@ namespace {
         // Use TooJPEG to encode
         bool success = TooJpeg::writeJpeg(
             jpegWriteCallback,
-            img.data.data(),
-            static_cast<unsigned short>(img.width),
-            static_cast<unsigned short>(img.height),
-            true,   // isRGB
+            pixels,
+            static_cast<unsigned short>(width),
+            static_cast<unsigned short>(height),
+            components == 3, // isRGB, single channel images are written as grayscale
             85,     // quality
             false,  // downsample
             nullptr // comment
@@ -46,139 +54,380 @@ namespace {
         return jpegData;
     }
 
-    // Compare two RGB images and return number of different pixels (ULTRA FAST - no decoding)
+    // Rows visited per pass in interleaved order: 0, 8, 16, ... first, then 1, 9, 17, ... and so on
+    constexpr int kInterleaveStride = 8;
+
+    enum class ScanOrder { Linear, Interleaved };
+
+    struct CompareOptions {
+        int channels = 3;
+        // 0 scans the whole frame, otherwise the scan ends on the first row that brings the count to this
+        size_t stopAfter = 0;
+        ScanOrder scanOrder = ScanOrder::Linear;
+        // 0 counts the frame as a whole, otherwise per tile of this many pixels square as well
+        int tileSize = 0;
+    };
+
+    // Compare two RGB images and return number of different pixels (ULTRA FAST - no decoding). With stopAfter
+    // the result is only exact below the limit, anything at or above it means the limit was reached
     size_t CompareRgbImagesDirect(const unsigned char* data1,
                                   const unsigned char* data2,
                                   int width,
                                   int height,
-                                  double threshold) {
+                                  double threshold,
+                                  const CompareOptions& options,
+                                  std::vector<uint16_t>& tiles) {
         const int thresholdInt = static_cast<int>(threshold * 255.0);
+        const size_t totalPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
 
+        // Runs on every frame, so it goes through the widest vector kernel the CPU has
+        const DiffKernels& kernels = GetDiffKernels();
+        const DiffKernel count = options.channels == 1 ? kernels.countLuma : kernels.countRgb;
+        if (options.tileSize > 0) {
+            const size_t columns = (width + options.tileSize - 1) / options.tileSize;
+            const size_t rows = (height + options.tileSize - 1) / options.tileSize;
+            tiles.resize(columns * rows);
+            return CountDiffTiles(count, data1, data2, width, height, options.channels, thresholdInt,
+                                  options.tileSize, tiles.data());
+        }
+        if (options.stopAfter == 0) {
+            return count(data1, data2, totalPixels, thresholdInt);
+        }
+
+        // Row by row, so a frame that is going to alert anyway stops being read as soon as it does. Interleaving
+        // samples the whole frame in the first pass, a large motion at the bottom is found after 1/8 of the work
+        const size_t rowBytes = static_cast<size_t>(width) * options.channels;
+        const int stride = options.scanOrder == ScanOrder::Interleaved ? kInterleaveStride : 1;
         size_t diffPixels = 0;
-        const size_t totalPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+        for (int first = 0; first < stride; ++first) {
+            for (int y = first; y < height; y += stride) {
+                const size_t offset = static_cast<size_t>(y) * rowBytes;
+                diffPixels += count(data1 + offset, data2 + offset, static_cast<size_t>(width), thresholdInt);
+                if (diffPixels >= options.stopAfter) {
+                    return diffPixels;
+                }
+            }
+        }
+        return diffPixels;
+    }
 
-        for (size_t i = 0; i < totalPixels; ++i) {
-            const size_t pixelOffset = i * 3;
+    // Optional trailing {channels} argument: 3 for RGB (default), 1 for luma only frames
+    int ParseChannels(Napi::Env env, const Napi::Value& value) {
+        if (value.IsUndefined() || value.IsNull()) {
+            return 3;
+        }
+        if (!value.IsObject()) {
+            throw Napi::TypeError::New(env, "Options must be an object");
+        }
+        Napi::Value channels = value.As<Napi::Object>().Get("channels");
+        if (channels.IsUndefined()) {
+            return 3;
+        }
+        if (!channels.IsNumber()) {
+            throw Napi::TypeError::New(env, "channels must be a number");
+        }
+        int result = channels.As<Napi::Number>().Int32Value();
+        if (result != 1 && result != 3) {
+            throw Napi::RangeError::New(env, "channels must be 1 or 3");
+        }
+        return result;
+    }
 
-            const int rDiff = std::abs(static_cast<int>(data1[pixelOffset]) - static_cast<int>(data2[pixelOffset]));
-            const int gDiff = std::abs(static_cast<int>(data1[pixelOffset + 1]) - static_cast<int>(data2[pixelOffset + 1]));
-            const int bDiff = std::abs(static_cast<int>(data1[pixelOffset + 2]) - static_cast<int>(data2[pixelOffset + 2]));
+    // Optional trailing {channels, stopAfter, scanOrder, tileSize} argument of compareRgbImages
+    CompareOptions ParseCompareOptions(Napi::Env env, const Napi::Value& value) {
+        CompareOptions options;
+        options.channels = ParseChannels(env, value);
+        if (value.IsUndefined() || value.IsNull()) {
+            return options;
+        }
+        Napi::Object object = value.As<Napi::Object>();
 
-            const int avgDiff = (rDiff + gDiff + bDiff) / 3;
+        Napi::Value stopAfter = object.Get("stopAfter");
+        if (!stopAfter.IsUndefined()) {
+            if (!stopAfter.IsNumber()) {
+                throw Napi::TypeError::New(env, "stopAfter must be a number");
+            }
+            const double limit = stopAfter.As<Napi::Number>().DoubleValue();
+            if (!(limit >= 0) || limit != std::floor(limit)) {
+                throw Napi::RangeError::New(env, "stopAfter must be a non-negative integer");
+            }
+            // Anything past the largest frame is never reached, same as no limit
+            options.stopAfter = limit > 1e9 ? 0 : static_cast<size_t>(limit);
+        }
 
-            if (avgDiff > thresholdInt) {
-                ++diffPixels;
+        Napi::Value scanOrder = object.Get("scanOrder");
+        if (!scanOrder.IsUndefined()) {
+            if (!scanOrder.IsString()) {
+                throw Napi::TypeError::New(env, "scanOrder must be a string");
+            }
+            const std::string order = scanOrder.As<Napi::String>().Utf8Value();
+            if (order == "interleaved") {
+                options.scanOrder = ScanOrder::Interleaved;
+            } else if (order != "linear") {
+                throw Napi::RangeError::New(env, "scanOrder must be 'linear' or 'interleaved'");
             }
         }
 
-        return diffPixels;
+        Napi::Value tileSize = object.Get("tileSize");
+        if (!tileSize.IsUndefined()) {
+            if (!tileSize.IsNumber()) {
+                throw Napi::TypeError::New(env, "tileSize must be a number");
+            }
+            options.tileSize = tileSize.As<Napi::Number>().Int32Value();
+            if (options.tileSize < 1 || options.tileSize > kMaxDiffTileSize) {
+                throw Napi::RangeError::New(env, "tileSize must be between 1 and 255");
+            }
+            // Every tile needs its full count
+            if (options.stopAfter > 0) {
+                throw Napi::RangeError::New(env, "stopAfter can't be combined with tileSize");
+            }
+        }
+        return options;
     }
 
-    class ImageComparisonWorker : public Napi::AsyncWorker {
+    // Heavy image work runs on the addon's own TaskScheduler instead of libuv's threadpool. Results come back
+    // through one thread-safe function and settle the job's promise on the JS thread
+    class ImageJob {
     public:
-        ImageComparisonWorker(Napi::Function& callback,
-                              std::vector<unsigned char> buffer1Data,
-                              std::vector<unsigned char> buffer2Data,
-                              int width,
-                              int height,
-                              double threshold,
-                              Napi::Promise::Deferred deferred)
-            : Napi::AsyncWorker(callback, "ImageComparisonWorker"),
-              buffer1Data(std::move(buffer1Data)),
-              buffer2Data(std::move(buffer2Data)),
-              width(width),
-              height(height),
-              threshold(threshold),
-              deferred(std::move(deferred)) {}
+        explicit ImageJob(Napi::Promise::Deferred deferred) : deferred(std::move(deferred)) {}
+        virtual ~ImageJob() = default;
+
+        // JS thread. Keeps a JS buffer alive until the job is deleted, so Execute() can read it in place
+        // instead of working on a copy. The caller must not write to it before the promise settles
+        const unsigned char* Pin(const Napi::Buffer<unsigned char>& buffer) {
+            pinned.push_back(Napi::Persistent(buffer));
+            return buffer.Data();
+        }
 
-        void Execute() override {
+        // Scheduler thread, the job is dropped without settling. References may only be deleted on the JS
+        // thread, the environment frees them on teardown anyway
+        void Abandon() {
+            for (auto& reference : pinned) {
+                reference.SuppressDestruct();
+            }
+        }
+
+        // Scheduler thread
+        void Run() {
             try {
-                diffPixels = CompareRgbImagesDirect(
-                    buffer1Data.data(),
-                    buffer2Data.data(),
-                    width,
-                    height,
-                    threshold
-                );
+                Execute();
             } catch (const std::exception& e) {
-                SetError(e.what());
+                failed = true;
+                error = e.what();
             }
         }
 
-        void OnOK() override {
-            Napi::Env env = Env();
+        // JS thread
+        void Settle(Napi::Env env) {
             Napi::HandleScope scope(env);
-            deferred.Resolve(Napi::Number::New(env, static_cast<double>(diffPixels)));
+            if (failed) {
+                deferred.Reject(Napi::Error::New(env, error).Value());
+            } else {
+                deferred.Resolve(Result(env));
+            }
         }
 
-        void OnError(const Napi::Error& e) override {
-            Napi::Env env = Env();
-            Napi::HandleScope scope(env);
-            deferred.Reject(e.Value());
+    protected:
+        virtual void Execute() = 0;
+        virtual Napi::Value Result(Napi::Env env) = 0;
+
+    private:
+        Napi::Promise::Deferred deferred;
+        std::vector<Napi::ObjectReference> pinned;
+        bool failed{false};
+        std::string error;
+    };
+
+    class ImageComparisonJob : public ImageJob {
+    public:
+        ImageComparisonJob(const Napi::Buffer<unsigned char>& buffer1,
+                           const Napi::Buffer<unsigned char>& buffer2,
+                           int width,
+                           int height,
+                           double threshold,
+                           const CompareOptions& options,
+                           Napi::Promise::Deferred deferred)
+            : ImageJob(std::move(deferred)),
+              buffer1Data(Pin(buffer1)),
+              buffer2Data(Pin(buffer2)),
+              width(width),
+              height(height),
+              threshold(threshold),
+              options(options) {}
+
+    protected:
+        void Execute() override {
+            diffPixels = CompareRgbImagesDirect(
+                buffer1Data,
+                buffer2Data,
+                width,
+                height,
+                threshold,
+                options,
+                tiles
+            );
+        }
+
+        Napi::Value Result(Napi::Env env) override {
+            if (options.tileSize == 0) {
+                return Napi::Number::New(env, static_cast<double>(diffPixels));
+            }
+            Napi::Uint16Array tileCounts = Napi::Uint16Array::New(env, tiles.size());
+            std::copy(tiles.begin(), tiles.end(), tileCounts.Data());
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("diffPixels", Napi::Number::New(env, static_cast<double>(diffPixels)));
+            result.Set("tiles", tileCounts);
+            result.Set("columns", Napi::Number::New(env, (width + options.tileSize - 1) / options.tileSize));
+            result.Set("rows", Napi::Number::New(env, (height + options.tileSize - 1) / options.tileSize));
+            result.Set("tileSize", Napi::Number::New(env, options.tileSize));
+            return result;
         }
 
     private:
-        std::vector<unsigned char> buffer1Data;
-        std::vector<unsigned char> buffer2Data;
+        const unsigned char* buffer1Data;
+        const unsigned char* buffer2Data;
         int width;
         int height;
         double threshold;
+        CompareOptions options;
         size_t diffPixels{0};
-        Napi::Promise::Deferred deferred;
+        std::vector<uint16_t> tiles;
     };
 
-    class JpegConversionWorker : public Napi::AsyncWorker {
+    // Same pass as ImageComparisonJob, but keeps the difference of every pixel as a histogram so the count for
+    // any threshold can be worked out afterwards
+    class ImageHistogramJob : public ImageJob {
     public:
-        JpegConversionWorker(Napi::Function& callback,
-                             std::vector<unsigned char> bufferData,
-                             int width,
-                             int height,
-                             Napi::Promise::Deferred deferred)
-            : Napi::AsyncWorker(callback, "JpegConversionWorker"),
-              bufferData(std::move(bufferData)),
+        ImageHistogramJob(const Napi::Buffer<unsigned char>& buffer1,
+                          const Napi::Buffer<unsigned char>& buffer2,
+                          int width,
+                          int height,
+                          int channels,
+                          Napi::Promise::Deferred deferred)
+            : ImageJob(std::move(deferred)),
+              buffer1Data(Pin(buffer1)),
+              buffer2Data(Pin(buffer2)),
               width(width),
               height(height),
-              deferred(std::move(deferred)) {}
+              channels(channels) {}
 
+    protected:
         void Execute() override {
-            try {
-                SimpleImage img;
-                img.width = width;
-                img.height = height;
-                img.components = 3;
-                img.data = bufferData;
-
-                jpegResult = EncodeJPEG(img);
-                if (jpegResult.empty()) {
-                    SetError("Failed to encode JPEG image");
-                }
-            } catch (const std::exception& e) {
-                SetError(e.what());
-            }
+            const size_t totalPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+            (channels == 1 ? DiffHistogramLuma : DiffHistogramRgb)(buffer1Data, buffer2Data, totalPixels,
+                                                                   bins.data());
         }
 
-        void OnOK() override {
-            Napi::Env env = Env();
-            Napi::HandleScope scope(env);
-            deferred.Resolve(Napi::Buffer<unsigned char>::Copy(env, jpegResult.data(), jpegResult.size()));
+        Napi::Value Result(Napi::Env env) override {
+            Napi::Uint32Array result = Napi::Uint32Array::New(env, bins.size());
+            std::copy(bins.begin(), bins.end(), result.Data());
+            return result;
         }
 
-        void OnError(const Napi::Error& e) override {
-            Napi::Env env = Env();
-            Napi::HandleScope scope(env);
-            deferred.Reject(e.Value());
+    private:
+        const unsigned char* buffer1Data;
+        const unsigned char* buffer2Data;
+        int width;
+        int height;
+        int channels;
+        std::array<uint32_t, kDiffHistogramBins> bins{};
+    };
+
+    class JpegConversionJob : public ImageJob {
+    public:
+        JpegConversionJob(const Napi::Buffer<unsigned char>& buffer,
+                          int width,
+                          int height,
+                          int channels,
+                          Napi::Promise::Deferred deferred)
+            : ImageJob(std::move(deferred)),
+              bufferData(Pin(buffer)),
+              width(width),
+              height(height),
+              channels(channels) {}
+
+    protected:
+        void Execute() override {
+            jpegResult = std::make_unique<std::vector<unsigned char>>(EncodeJPEG(bufferData, width, height, channels));
+            if (jpegResult->empty()) {
+                throw std::runtime_error("Failed to encode JPEG image");
+            }
+        }
+
+        // The encoded vector becomes the buffer's backing store and is freed with it
+        Napi::Value Result(Napi::Env env) override {
+            std::vector<unsigned char>* jpeg = jpegResult.release();
+            return Napi::Buffer<unsigned char>::NewOrCopy(
+                env,
+                jpeg->data(),
+                jpeg->size(),
+                [](Napi::Env, unsigned char*, std::vector<unsigned char>* owner) { delete owner; },
+                jpeg
+            );
         }
 
     private:
-        std::vector<unsigned char> bufferData;
-        std::vector<unsigned char> jpegResult;
+        const unsigned char* bufferData;
+        std::unique_ptr<std::vector<unsigned char>> jpegResult;
         int width;
         int height;
-        Napi::Promise::Deferred deferred;
+        int channels;
     };
+
 }
 
 namespace ImageProc {
+    // Per-environment, JS thread only. The scheduler is created on first use with whatever
+    // configureImageWorkers() set
+    struct InstanceData {
+        TaskSchedulerOptions schedulerOptions;
+        std::unique_ptr<TaskScheduler> scheduler;
+        Napi::ThreadSafeFunction settleJob;
+        size_t pendingJobs = 0;
+    };
+
+    static InstanceData& GetInstanceData(Napi::Env env) {
+        return *GetAddonData(env).imageProc;
+    }
+
+    static TaskScheduler& Scheduler(InstanceData& data) {
+        if (!data.scheduler) {
+            data.scheduler = std::make_unique<TaskScheduler>(data.schedulerOptions);
+        }
+        return *data.scheduler;
+    }
+
+    static void Dispatch(Napi::Env env, std::unique_ptr<ImageJob> job) {
+        InstanceData* data = &GetInstanceData(env);
+        if (!data->settleJob) {
+            data->settleJob = Napi::ThreadSafeFunction::New(
+                env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "ImageJobs", 0, 1);
+            data->settleJob.Unref(env);
+        }
+        // Referenced only while jobs are pending, so outstanding promises keep the process alive like queued
+        // AsyncWorkers did and an idle addon doesn't
+        if (data->pendingJobs++ == 0) {
+            data->settleJob.Ref(env);
+        }
+
+        ImageJob* pending = job.release();
+        Scheduler(*data).Submit([data, pending]() {
+            pending->Run();
+            napi_status status = data->settleJob.BlockingCall(pending, [data](Napi::Env env, Napi::Function, ImageJob* done) {
+                done->Settle(env);
+                delete done;
+                if (--data->pendingJobs == 0) {
+                    data->settleJob.Unref(env);
+                }
+            });
+            if (status != napi_ok) {
+                // The environment is shutting down, nobody is waiting for the promise any more
+                pending->Abandon();
+                delete pending;
+            }
+        });
+    }
+
     Napi::Value ConvertRgbToJpeg(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -198,25 +447,23 @@ namespace ImageProc {
             throw Napi::RangeError::New(env, "Invalid image dimensions");
         }
 
-        const size_t expectedSize = static_cast<size_t>(width) * static_cast<size_t>(height) * 3;
+        const int channels = ParseChannels(env, info[3]);
+        const size_t expectedSize = static_cast<size_t>(width) * static_cast<size_t>(height) * channels;
         if (buffer.Length() < expectedSize) {
             throw Napi::Error::New(env, "Buffer too small for specified dimensions");
         }
 
         Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
-        Napi::Function dummyCallback = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
-
-        auto worker = new JpegConversionWorker(
-            dummyCallback,
-            std::vector<unsigned char>(buffer.Data(), buffer.Data() + expectedSize),
+        Napi::Promise promise = deferred.Promise();
+        Dispatch(env, std::make_unique<JpegConversionJob>(
+            buffer,
             width,
             height,
+            channels,
             deferred
-        );
-
-        worker->Queue();
+        ));
 
-        return deferred.Promise();
+        return promise;
     }
 
     Napi::Value CompareRgbImages(const Napi::CallbackInfo& info) {
@@ -245,32 +492,153 @@ namespace ImageProc {
             throw Napi::RangeError::New(env, "Threshold must be between 0 and 1");
         }
 
-        const size_t expectedSize = static_cast<size_t>(width) * static_cast<size_t>(height) * 3;
+        const CompareOptions options = ParseCompareOptions(env, info[5]);
+        const size_t expectedSize = static_cast<size_t>(width) * static_cast<size_t>(height) * options.channels;
         if (buffer1.Length() < expectedSize || buffer2.Length() < expectedSize) {
             throw Napi::Error::New(env, "Buffer too small for specified dimensions");
         }
 
         Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
-        Napi::Function dummyCallback = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
-
-        auto worker = new ImageComparisonWorker(
-            dummyCallback,
-            std::vector<unsigned char>(buffer1.Data(), buffer1.Data() + expectedSize),
-            std::vector<unsigned char>(buffer2.Data(), buffer2.Data() + expectedSize),
+        Napi::Promise promise = deferred.Promise();
+        Dispatch(env, std::make_unique<ImageComparisonJob>(
+            buffer1,
+            buffer2,
             width,
             height,
             threshold,
+            options,
             deferred
-        );
+        ));
+
+        return promise;
+    }
+
+    Napi::Value CompareRgbImagesHistogram(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 4) {
+            throw Napi::TypeError::New(env, "Wrong number of arguments");
+        }
+
+        if (!info[0].IsBuffer() || !info[1].IsBuffer() || !info[2].IsNumber() || !info[3].IsNumber()) {
+            throw Napi::TypeError::New(env, "Arguments must be: buffer1, buffer2, width, height");
+        }
+
+        Napi::Buffer<unsigned char> buffer1 = info[0].As<Napi::Buffer<unsigned char>>();
+        Napi::Buffer<unsigned char> buffer2 = info[1].As<Napi::Buffer<unsigned char>>();
+        int width = info[2].As<Napi::Number>().Int32Value();
+        int height = info[3].As<Napi::Number>().Int32Value();
+
+        if (width <= 0 || height <= 0 || width > 10000 || height > 10000) {
+            throw Napi::RangeError::New(env, "Invalid image dimensions");
+        }
+
+        const int channels = ParseChannels(env, info[4]);
+        const size_t expectedSize = static_cast<size_t>(width) * static_cast<size_t>(height) * channels;
+        if (buffer1.Length() < expectedSize || buffer2.Length() < expectedSize) {
+            throw Napi::Error::New(env, "Buffer too small for specified dimensions");
+        }
+
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        Napi::Promise promise = deferred.Promise();
+        Dispatch(env, std::make_unique<ImageHistogramJob>(
+            buffer1,
+            buffer2,
+            width,
+            height,
+            channels,
+            deferred
+        ));
+
+        return promise;
+    }
+
+    Napi::Value ConfigureImageWorkers(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
 
-        worker->Queue();
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            throw Napi::TypeError::New(env, "Options must be an object");
+        }
+        InstanceData& data = GetInstanceData(env);
+        if (data.scheduler) {
+            throw Napi::Error::New(env, "Image workers are already running, configure them before the first job");
+        }
+
+        Napi::Object options = info[0].As<Napi::Object>();
+        TaskSchedulerOptions parsed;
+
+        Napi::Value threads = options.Get("threads");
+        if (!threads.IsUndefined()) {
+            if (!threads.IsNumber()) {
+                throw Napi::TypeError::New(env, "threads must be a number");
+            }
+            double value = threads.As<Napi::Number>().DoubleValue();
+            if (value < 0 || value > 64 || value != std::floor(value)) {
+                throw Napi::RangeError::New(env, "threads must be an integer between 0 and 64");
+            }
+            parsed.threads = static_cast<size_t>(value);
+        }
+
+        Napi::Value affinity = options.Get("affinity");
+        if (!affinity.IsUndefined()) {
+            if (!affinity.IsArray()) {
+                throw Napi::TypeError::New(env, "affinity must be an array of CPU indexes");
+            }
+            Napi::Array cpus = affinity.As<Napi::Array>();
+            for (uint32_t i = 0; i < cpus.Length(); ++i) {
+                Napi::Value cpu = cpus.Get(i);
+                if (!cpu.IsNumber()) {
+                    throw Napi::TypeError::New(env, "affinity must be an array of CPU indexes");
+                }
+                double value = cpu.As<Napi::Number>().DoubleValue();
+                if (value < 0 || value > 1023 || value != std::floor(value)) {
+                    throw Napi::RangeError::New(env, "affinity CPU indexes must be integers between 0 and 1023");
+                }
+                parsed.affinity.push_back(static_cast<int>(value));
+            }
+        }
 
-        return deferred.Promise();
+        data.schedulerOptions = std::move(parsed);
+        return Napi::Number::New(env, static_cast<double>(Scheduler(data).ThreadCount()));
+    }
+
+    Napi::Value GetImageWorkerStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        // Before the first job there are no threads yet. Starting them here would make a later
+        // configureImageWorkers() fail, so report zeros instead
+        InstanceData& data = GetInstanceData(env);
+        const TaskSchedulerStats stats = data.scheduler ? data.scheduler->GetStats() : TaskSchedulerStats{};
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("threads", Napi::Number::New(env, static_cast<double>(stats.threads)));
+        result.Set("queued", Napi::Number::New(env, static_cast<double>(stats.queued)));
+        Napi::Array depths = Napi::Array::New(env, stats.queueDepths.size());
+        for (size_t i = 0; i < stats.queueDepths.size(); ++i) {
+            depths.Set(static_cast<uint32_t>(i), Napi::Number::New(env, static_cast<double>(stats.queueDepths[i])));
+        }
+        result.Set("queueDepths", depths);
+        result.Set("running", Napi::Number::New(env, static_cast<double>(stats.running)));
+        result.Set("submitted", Napi::Number::New(env, static_cast<double>(stats.submitted)));
+        result.Set("completed", Napi::Number::New(env, static_cast<double>(stats.completed)));
+        result.Set("steals", Napi::Number::New(env, static_cast<double>(stats.steals)));
+        return result;
     }
 
     Napi::Object Init(Napi::Env env, Napi::Object exports) {
+        auto* data = new InstanceData();
+        GetAddonData(env).imageProc = data;
+        // Joins the workers while the environment still exists, jobs settling after this are dropped
+        env.AddCleanupHook([data]() {
+            data->scheduler.reset();
+            delete data;
+        });
+
         exports.Set(Napi::String::New(env, "convertRgbToJpeg"), Napi::Function::New(env, ConvertRgbToJpeg));
         exports.Set(Napi::String::New(env, "compareRgbImages"), Napi::Function::New(env, CompareRgbImages));
+        exports.Set(Napi::String::New(env, "compareRgbImagesHistogram"),
+                    Napi::Function::New(env, CompareRgbImagesHistogram));
+        exports.Set(Napi::String::New(env, "configureImageWorkers"), Napi::Function::New(env, ConfigureImageWorkers));
+        exports.Set(Napi::String::New(env, "getImageWorkerStats"), Napi::Function::New(env, GetImageWorkerStats));
         return exports;
     }
 }
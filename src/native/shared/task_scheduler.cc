@@ -0,0 +1,157 @@
+#include "task_scheduler.h"
+
+#include "logger.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    // Lets Submit() from inside a task push onto the running thread's own deque
+    thread_local const TaskScheduler* tScheduler = nullptr;
+    thread_local size_t tWorkerIndex = 0;
+
+    size_t ResolveThreads(size_t threads) {
+        if (threads > 0) {
+            return threads;
+        }
+        size_t cores = std::thread::hardware_concurrency();
+        return std::max<size_t>(2, std::min(cores, TaskScheduler::kMaxAutoThreads));
+    }
+}
+
+TaskScheduler::TaskScheduler(const TaskSchedulerOptions& options) {
+    const size_t threads = ResolveThreads(options.threads);
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread(&TaskScheduler::WorkerLoop, this, i);
+        if (!options.affinity.empty()) {
+            PinThread(workers_[i]->thread, options.affinity[i % options.affinity.size()]);
+        }
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void TaskScheduler::Submit(Task task) {
+    const size_t index = tScheduler == this ? tWorkerIndex : nextWorker_.fetch_add(1) % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+        queued_.fetch_add(1);
+    }
+    submitted_.fetch_add(1);
+    {
+        // Pairs with the predicate check in WorkerLoop so a thread about to sleep can't miss the task
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    wake_.notify_one();
+}
+
+bool TaskScheduler::TakeTask(size_t index, Task& task) {
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(index + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            steals_.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::WorkerLoop(size_t index) {
+    tScheduler = this;
+    tWorkerIndex = index;
+
+    while (true) {
+        Task task;
+        if (TakeTask(index, task)) {
+            running_.fetch_add(1);
+            task();
+            running_.fetch_sub(1);
+            completed_.fetch_add(1);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        // Drained first: a queued task may be the only thing that settles its promise
+        if (stopping_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::PinThread(std::thread& thread, int cpu) {
+#ifdef _WIN32
+    if (cpu < 0 || cpu >= 64 ||
+        SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << cpu) == 0) {
+        LOG_GENERIC_ERR("eimg", "Failed to pin image worker to CPU " << cpu);
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        LOG_GENERIC_ERR("eimg", "Failed to pin image worker to CPU " << cpu << ": out of range");
+        return;
+    }
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (err != 0) {
+        LOG_GENERIC_ERR("eimg", "Failed to pin image worker to CPU " << cpu << ": " << err);
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+TaskSchedulerStats TaskScheduler::GetStats() const {
+    TaskSchedulerStats stats;
+    stats.threads = workers_.size();
+    stats.queueDepths.reserve(workers_.size());
+    for (const auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        stats.queueDepths.push_back(worker->tasks.size());
+        stats.queued += worker->tasks.size();
+    }
+    stats.running = running_.load();
+    stats.submitted = submitted_.load();
+    stats.completed = completed_.load();
+    stats.steals = steals_.load();
+    return stats;
+}
@@ -0,0 +1,78 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t threads) {
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Run(size_t count, const std::function<void(size_t)>& task) {
+    std::lock_guard<std::mutex> runLock(runMutex_);
+    {
+        // A worker that woke up late for the previous job may still be leaving it
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return busy_ == 0; });
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    Work();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Every index is claimed once Work() returns, workers still busy are finishing theirs
+    idle_.wait(lock, [this] { return busy_ == 0; });
+    task_ = nullptr;
+    count_ = 0;
+}
+
+void WorkerPool::WorkerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        ++busy_;
+        lock.unlock();
+
+        Work();
+
+        lock.lock();
+        if (--busy_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void WorkerPool::Work() {
+    while (true) {
+        size_t index;
+        const std::function<void(size_t)>* task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (next_ >= count_) {
+                return;
+            }
+            index = next_++;
+            task = task_;
+        }
+        (*task)(index);
+    }
+}
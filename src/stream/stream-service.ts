@@ -1,6 +1,6 @@
 import {Inject, Injectable, Logger} from '@nestjs/common';
 import type {FrameDetector} from '@/app/app-model';
-import {INativeModule, Native, FrameData} from '@/native/native-model';
+import {INativeModule, Native, FrameData, NativeCaptureOptions, NativeCaptureEvent} from '@/native/native-model';
 import {CameraConfData} from '@/config/config-resolve-model';
 import {CameraConfig} from '@/config/config-zod-schema';
 
@@ -28,13 +28,44 @@ export class StreamService {
         // eslint-disable-next-line @typescript-eslint/no-misused-promises
         void frameListener.onNewFrame(frameInfo as FrameData);
       }
-    });
+    }, this.captureOptions(), (event: NativeCaptureEvent) => this.onCaptureEvent(event));
     this.logger.log(`DirectShow capture started for device: ${this.conf.name}`);
   }
 
+  private captureOptions(): NativeCaptureOptions {
+    return {
+      bufferCount: this.conf.bufferCount,
+      latestFrameOnly: this.conf.latestFrameOnly,
+      minWidth: this.conf.minWidth,
+      minHeight: this.conf.minHeight,
+      decodeScale: this.conf.decodeScale,
+      grayscale: this.conf.grayscale,
+      dctDetection: this.conf.dctDetection,
+      conversionThreads: this.conf.conversionThreads,
+      stallTimeoutMs: this.conf.stallTimeoutMs,
+      userPtr: this.conf.userPtr,
+      rawFrames: this.conf.rawFrames,
+    };
+  }
+
+  // The native watchdog reopens a lost camera in place, so the process only exits when nobody is reconnecting
+  private onCaptureEvent(event: NativeCaptureEvent): void {
+    clearTimeout(this.exitTimeout!);
+    if (event.type === 'lost') {
+      this.logger.warn(`Lost camera ${event.device}: ${event.message}, reconnecting`);
+    } else if (event.type === 'retry') {
+      this.logger.warn(`Reconnect attempt ${event.attempt} to ${event.device} failed: ${event.message}`);
+    } else {
+      this.logger.log(`Reconnected to ${event.device} after ${event.attempt} attempts in ${Math.round(event.durationMs)}ms`);
+      this.exitOnTimeout();
+    }
+  }
+
   private exitOnTimeout(): void {
+    // Leaves the native watchdog time to notice a stall first
+    const timeoutMs = Math.max(5000, 2 * (this.conf.stallTimeoutMs ?? 0));
     this.exitTimeout = setTimeout(() => {
-      throw Error('Frame capturing didn\'t produce any data for 5s, exiting...');
-    }, 5000);
+      throw Error(`Frame capturing didn't produce any data for ${timeoutMs / 1000}s, exiting...`);
+    }, timeoutMs);
   }
 }
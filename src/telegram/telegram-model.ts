@@ -3,4 +3,5 @@ export enum TelegramCommands {
   set_threshold = 'set_threshold',
   increase_threshold = 'increase_threshold',
   decrease_threshold = 'decrease_threshold',
+  set_sensitivity = 'set_sensitivity',
 }
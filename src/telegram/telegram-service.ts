@@ -41,11 +41,16 @@ export class TelegramService {
         command: TelegramCommands.decrease_threshold,
         description: 'Reduces the amount of pixels related to current value to spot a diff',
       },
+      {
+        command: TelegramCommands.set_sensitivity,
+        description: 'Sets how much a pixel has to change to count, from 0 to 1, lower = more aggressive',
+      },
     ]);
     this.bot.command(TelegramCommands.image, async() => commandListener.onAskImage());
     this.bot.command(TelegramCommands.set_threshold, async(a: CommandContextExtn) => commandListener.onSetThreshold(a));
     this.bot.command(TelegramCommands.increase_threshold, async() => commandListener.onIncreaseThreshold());
     this.bot.command(TelegramCommands.decrease_threshold, async() => commandListener.onDecreaseThreshold());
+    this.bot.command(TelegramCommands.set_sensitivity, async(a: CommandContextExtn) => commandListener.onSetSensitivity(a));
     await this.bot.launch();
   }
 
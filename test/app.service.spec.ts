@@ -37,9 +37,11 @@ describe('AppService', () => {
     mockImagelibService = {
       conf: {
         pixels: 100,
+        threshold: 0.1,
       },
       getLastImage: jest.fn(),
       getImageIfItsChanged: jest.fn(),
+      reevaluateLastFrame: jest.fn(),
     } as any;
 
     const module: TestingModule = await Test.createTestingModule({
@@ -92,6 +94,16 @@ describe('AppService', () => {
 
       expect(mockImagelibService.conf.pixels).toBe(Math.ceil(initialThreshold / 2));
       expect(mockTelegramService.sendText).toHaveBeenCalledWith(`Decreased threshold to ${Math.ceil(initialThreshold / 2)}`);
+      expect(mockImagelibService.reevaluateLastFrame).toHaveBeenCalled();
+    });
+
+    it('should send the last frame when it crosses the lowered threshold', async () => {
+      const mockImageBuffer = Buffer.from('fake-image-data');
+      mockImagelibService.reevaluateLastFrame.mockResolvedValue(mockImageBuffer);
+
+      await service.onDecreaseThreshold();
+
+      expect(mockTelegramService.sendImage).toHaveBeenCalledWith(mockImageBuffer);
     });
   });
 
@@ -119,6 +131,29 @@ describe('AppService', () => {
     });
   });
 
+  describe('onSetSensitivity', () => {
+    it('should set the per-pixel threshold and re-evaluate the last frame', async () => {
+      mockImagelibService.conf.threshold = 0.1;
+
+      await service.onSetSensitivity({payload: '0.05'} as any);
+
+      expect(mockImagelibService.conf.threshold).toBe(0.05);
+      expect(mockImagelibService.reevaluateLastFrame).toHaveBeenCalled();
+      expect(mockTelegramService.sendText).not.toHaveBeenCalled();
+    });
+
+    it('should reject values outside 0 to 1', async () => {
+      mockImagelibService.conf.threshold = 0.1;
+
+      await service.onSetSensitivity({payload: '2'} as any);
+      await service.onSetSensitivity({payload: ''} as any);
+
+      expect(mockImagelibService.conf.threshold).toBe(0.1);
+      expect(mockImagelibService.reevaluateLastFrame).not.toHaveBeenCalled();
+      expect(mockTelegramService.sendText).toHaveBeenCalledWith('set_sensitivity requires a number from 0 to 1. 2 is not one');
+    });
+  });
+
   describe('onSetThreshold', () => {
     it('should set threshold when valid number provided', async () => {
       const mockContext: CommandContextExtn = {
@@ -129,6 +164,7 @@ describe('AppService', () => {
 
       expect(mockImagelibService.conf.pixels).toBe(150);
       expect(mockTelegramService.sendText).not.toHaveBeenCalled();
+      expect(mockImagelibService.reevaluateLastFrame).toHaveBeenCalled();
     });
 
     it('should send error message when invalid number provided', async () => {
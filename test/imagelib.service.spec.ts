@@ -61,6 +61,24 @@ describe('ImagelibService', () => {
     expect(service.conf).toBe(mockDiffConfig);
   });
 
+  describe('onModuleInit', () => {
+    it('should configure native image workers from diff config', () => {
+      mockNative.configureImageWorkers = jest.fn().mockReturnValue(4);
+      mockDiffConfig.workerThreads = 4;
+      mockDiffConfig.workerAffinity = [2, 3];
+
+      service.onModuleInit();
+
+      expect(mockNative.configureImageWorkers).toHaveBeenCalledWith({threads: 4, affinity: [2, 3]});
+      expect(mockLogger.log).toHaveBeenCalledWith('Comparing and encoding images on 4 native threads');
+    });
+
+    it('should skip configuration when the native module has no image workers', () => {
+      expect(() => service.onModuleInit()).not.toThrow();
+      expect(mockLogger.log).not.toHaveBeenCalled();
+    });
+  });
+
   describe('getLastImage', () => {
     it('should return null when no frame is stored', async () => {
       const result = await service.getLastImage();
@@ -91,10 +109,38 @@ describe('ImagelibService', () => {
       expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(
         mockFrameData.buffer,
         mockFrameData.width,
-        mockFrameData.height
+        mockFrameData.height,
+        {channels: 3}
       );
       expect(result).toBe(mockJpegBuffer);
     });
+
+    it('should encode a snapshot instead of the stored luma frame when available', async () => {
+      const lumaFrame: FrameData = {
+        buffer: Buffer.from('fake-luma-data'),
+        width: 640,
+        height: 480,
+        dataSize: 640 * 480,
+        channels: 1,
+      };
+      const snapshot = {
+        buffer: Buffer.from('fake-rgb-data'),
+        width: 640,
+        height: 480,
+        dataSize: 640 * 480 * 3,
+        switchMs: 40,
+        restoreMs: 0,
+      };
+      const mockJpegBuffer = Buffer.from('fake-jpeg-data');
+      mockNative.captureSnapshot = jest.fn().mockResolvedValue(snapshot);
+      mockNative.convertRgbToJpeg.mockResolvedValue(mockJpegBuffer);
+      await service.getImageIfItsChanged(lumaFrame);
+
+      const result = await service.getLastImage();
+
+      expect(result).toBe(mockJpegBuffer);
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(snapshot.buffer, snapshot.width, snapshot.height, {channels: 3});
+    });
   });
 
   describe('getImageIfItsChanged', () => {
@@ -146,7 +192,8 @@ describe('ImagelibService', () => {
         secondFrame.buffer,
         secondFrame.width,
         secondFrame.height,
-        mockDiffConfig.threshold
+        mockDiffConfig.threshold,
+        {channels: 3, stopAfter: mockDiffConfig.pixels, scanOrder: 'interleaved'}
       );
       expect(mockNative.convertRgbToJpeg).not.toHaveBeenCalled();
       expect(mockLogger.log).not.toHaveBeenCalled();
@@ -174,12 +221,14 @@ describe('ImagelibService', () => {
         secondFrame.buffer,
         secondFrame.width,
         secondFrame.height,
-        mockDiffConfig.threshold
+        mockDiffConfig.threshold,
+        {channels: 3, stopAfter: mockDiffConfig.pixels, scanOrder: 'interleaved'}
       );
       expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(
         secondFrame.buffer,
         secondFrame.width,
-        secondFrame.height
+        secondFrame.height,
+        {channels: 3}
       );
       expect(mockLogger.log).toHaveBeenCalledWith(`⚠️ CHANGE DETECTED: ${mockDiffConfig.pixels} pixels`);
     });
@@ -235,8 +284,231 @@ describe('ImagelibService', () => {
         thirdFrame.buffer,
         thirdFrame.width,
         thirdFrame.height,
-        mockDiffConfig.threshold
+        mockDiffConfig.threshold,
+        {channels: 3, stopAfter: mockDiffConfig.pixels, scanOrder: 'interleaved'}
+      );
+    });
+
+    it('should compare and encode luma only frames as single channel', async () => {
+      const grayFrame: FrameData = {
+        buffer: Buffer.from('fake-luma-data'),
+        width: 480,
+        height: 270,
+        dataSize: 480 * 270,
+        scale: 4,
+        channels: 1,
+      };
+      const secondFrame = {
+        ...grayFrame,
+        buffer: Buffer.from('fake-luma-data-2'),
+      };
+      mockNative.compareRgbImages.mockResolvedValue(mockDiffConfig.pixels);
+      mockNative.convertRgbToJpeg.mockResolvedValue(Buffer.from('fake-jpeg-data'));
+
+      await service.getImageIfItsChanged(grayFrame);
+      await service.getImageIfItsChanged(secondFrame);
+
+      expect(mockNative.compareRgbImages).toHaveBeenCalledWith(
+        grayFrame.buffer,
+        secondFrame.buffer,
+        secondFrame.width,
+        secondFrame.height,
+        mockDiffConfig.threshold,
+        {channels: 1, stopAfter: mockDiffConfig.pixels, scanOrder: 'interleaved'}
+      );
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(secondFrame.buffer, secondFrame.width, secondFrame.height, {channels: 1});
+    });
+
+    it('should count changed samples of scaled frames in capture resolution pixels', async () => {
+      const blockFrame: FrameData = {
+        buffer: Buffer.from('fake-dc-plane'),
+        width: 240,
+        height: 135,
+        dataSize: 240 * 135,
+        scale: 8,
+        channels: 1,
+      };
+      await service.getImageIfItsChanged(blockFrame);
+
+      // 15 changed 8x8 blocks stand for 960 pixels, below the 1000 pixel threshold
+      mockNative.compareRgbImages.mockResolvedValue(15);
+      expect(await service.getImageIfItsChanged({...blockFrame, buffer: Buffer.from('fake-dc-plane-2')})).toBeNull();
+
+      mockNative.compareRgbImages.mockResolvedValue(16);
+      mockNative.convertRgbToJpeg.mockResolvedValue(Buffer.from('fake-jpeg-data'));
+      await service.getImageIfItsChanged({...blockFrame, buffer: Buffer.from('fake-dc-plane-3')});
+
+      expect(mockLogger.log).toHaveBeenCalledWith('⚠️ CHANGE DETECTED: 1024 pixels');
+      // 1000 pixels are 15.6 blocks, the native scan may stop at 16
+      expect(mockNative.compareRgbImages).toHaveBeenLastCalledWith(
+        blockFrame.buffer,
+        expect.any(Buffer),
+        blockFrame.width,
+        blockFrame.height,
+        mockDiffConfig.threshold,
+        {channels: 1, stopAfter: 16, scanOrder: 'interleaved'},
       );
     });
+
+    it('should send a full resolution snapshot when the native module has one', async () => {
+      const mockJpegBuffer = Buffer.from('fake-jpeg-data');
+      const snapshot = {
+        buffer: Buffer.from('fake-full-res-data'),
+        width: 3840,
+        height: 2160,
+        dataSize: 3840 * 2160 * 3,
+        switchMs: 120,
+        restoreMs: 80,
+      };
+      mockNative.captureSnapshot = jest.fn().mockResolvedValue(snapshot);
+
+      await service.getImageIfItsChanged(mockFrameData);
+      const secondFrame = {
+        ...mockFrameData,
+        buffer: Buffer.from('fake-rgb-data-2'),
+      };
+      mockNative.compareRgbImages.mockResolvedValue(mockDiffConfig.pixels);
+      mockNative.convertRgbToJpeg.mockResolvedValue(mockJpegBuffer);
+
+      const result = await service.getImageIfItsChanged(secondFrame);
+
+      expect(result).toBe(mockJpegBuffer);
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(snapshot.buffer, snapshot.width, snapshot.height, {channels: 3});
+      expect(mockNative.convertRgbToJpeg).not.toHaveBeenCalledWith(secondFrame.buffer, secondFrame.width, secondFrame.height, {channels: 3});
+    });
+
+    it('should fall back to the detection frame when the snapshot fails', async () => {
+      const mockJpegBuffer = Buffer.from('fake-jpeg-data');
+      mockNative.captureSnapshot = jest.fn().mockRejectedValue(new Error('switch failed'));
+
+      await service.getImageIfItsChanged(mockFrameData);
+      const secondFrame = {
+        ...mockFrameData,
+        buffer: Buffer.from('fake-rgb-data-2'),
+      };
+      mockNative.compareRgbImages.mockResolvedValue(mockDiffConfig.pixels);
+      mockNative.convertRgbToJpeg.mockResolvedValue(mockJpegBuffer);
+
+      const result = await service.getImageIfItsChanged(secondFrame);
+
+      expect(result).toBe(mockJpegBuffer);
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(secondFrame.buffer, secondFrame.width, secondFrame.height, {channels: 3});
+      expect(mockLogger.warn).toHaveBeenCalledWith('Full resolution snapshot failed, sending detection frame: switch failed');
+    });
+
+    it('should compare only the newest of the frames that arrive during a comparison', async () => {
+      await service.getImageIfItsChanged(mockFrameData);
+      let finishComparison: (diffPixels: number) => void = () => undefined;
+      mockNative.compareRgbImages.mockImplementationOnce(() => new Promise((resolve) => {
+        finishComparison = resolve;
+      }));
+      mockNative.compareRgbImages.mockResolvedValue(mockDiffConfig.pixels - 1);
+
+      const frames = [2, 3, 4].map((i) => ({...mockFrameData, buffer: Buffer.from(`fake-rgb-data-${i}`)}));
+      const results = frames.map((frame) => service.getImageIfItsChanged(frame));
+      expect(mockNative.compareRgbImages).toHaveBeenCalledTimes(1);
+
+      finishComparison(mockDiffConfig.pixels - 1);
+
+      expect(await Promise.all(results)).toEqual([null, null, null]);
+      expect(mockNative.compareRgbImages).toHaveBeenCalledTimes(2);
+      expect(mockNative.compareRgbImages).toHaveBeenLastCalledWith(
+        mockFrameData.buffer,
+        frames[2].buffer,
+        frames[2].width,
+        frames[2].height,
+        mockDiffConfig.threshold,
+        {channels: 3, stopAfter: mockDiffConfig.pixels, scanOrder: 'interleaved'},
+      );
+    });
+  });
+
+  describe('reevaluateLastFrame', () => {
+    const mockFrameData: FrameData = {
+      buffer: Buffer.from('fake-rgb-data'),
+      width: 640,
+      height: 480,
+      dataSize: 640 * 480 * 3,
+    };
+
+    // threshold 0.1 is 25 on the byte scale, only bins above it count
+    const histogramWith = (changed: number): Uint32Array => {
+      const histogram = new Uint32Array(256);
+      histogram[0] = 640 * 480 - changed - 7;
+      histogram[25] = 7;
+      histogram[200] = changed;
+      return histogram;
+    };
+
+    beforeEach(() => {
+      mockNative.compareRgbImagesHistogram = jest.fn().mockResolvedValue(histogramWith(600));
+      mockNative.convertRgbToJpeg.mockResolvedValue(Buffer.from('fake-jpeg-data'));
+    });
+
+    const compareBelowThreshold = async(): Promise<FrameData> => {
+      await service.getImageIfItsChanged(mockFrameData);
+      const secondFrame = {...mockFrameData, buffer: Buffer.from('fake-rgb-data-2')};
+      mockNative.compareRgbImages.mockResolvedValue(600);
+      expect(await service.getImageIfItsChanged(secondFrame)).toBeNull();
+      return secondFrame;
+    };
+
+    it('should return null before a frame pair was compared', async () => {
+      expect(await service.reevaluateLastFrame()).toBeNull();
+      await service.getImageIfItsChanged(mockFrameData);
+      expect(await service.reevaluateLastFrame()).toBeNull();
+      expect(mockNative.compareRgbImagesHistogram).not.toHaveBeenCalled();
+    });
+
+    it('should alert on the last frame pair once the pixel count is lowered, without a native pass', async () => {
+      const secondFrame = await compareBelowThreshold();
+
+      expect(await service.reevaluateLastFrame()).toBeNull();
+      expect(mockLogger.log).toHaveBeenCalledWith('Last frame has 600 changed pixels, below 1000');
+
+      mockDiffConfig.pixels = 500;
+      expect(await service.reevaluateLastFrame()).toEqual(Buffer.from('fake-jpeg-data'));
+      expect(mockLogger.log).toHaveBeenCalledWith('⚠️ CHANGE DETECTED: 600 pixels');
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledWith(secondFrame.buffer, secondFrame.width, secondFrame.height, {channels: 3});
+      expect(mockNative.compareRgbImagesHistogram).not.toHaveBeenCalled();
+
+      // The alerting frame is the new reference, there is no pair left to re-evaluate
+      expect(await service.reevaluateLastFrame()).toBeNull();
+    });
+
+    it('should recount the last frame pair from the histogram after a sensitivity change', async () => {
+      const secondFrame = await compareBelowThreshold();
+
+      mockDiffConfig.pixels = 607;
+      expect(await service.reevaluateLastFrame()).toBeNull();
+      expect(mockNative.compareRgbImagesHistogram).not.toHaveBeenCalled();
+
+      mockDiffConfig.threshold = 0.09;
+      expect(await service.reevaluateLastFrame()).not.toBeNull();
+      expect(mockNative.compareRgbImagesHistogram).toHaveBeenCalledWith(
+        mockFrameData.buffer,
+        secondFrame.buffer,
+        secondFrame.width,
+        secondFrame.height,
+        {channels: 3},
+      );
+      expect(mockLogger.log).toHaveBeenCalledWith('⚠️ CHANGE DETECTED: 607 pixels');
+    });
+
+    it('should not alert twice when a frame and a re-evaluation overlap', async () => {
+      await compareBelowThreshold();
+      mockDiffConfig.pixels = 500;
+      // The third frame looks like the second, both differ from the first
+      mockNative.compareRgbImages.mockImplementation(async(reference: Buffer) => (reference === mockFrameData.buffer ? 800 : 100));
+
+      const [fromReevaluation, fromFrame] = await Promise.all([
+        service.reevaluateLastFrame(),
+        service.getImageIfItsChanged({...mockFrameData, buffer: Buffer.from('fake-rgb-data-3')}),
+      ]);
+
+      expect(fromReevaluation).not.toBeNull();
+      expect(fromFrame).toBeNull();
+      expect(mockNative.convertRgbToJpeg).toHaveBeenCalledTimes(1);
+    });
   });
 });
@@ -0,0 +1,164 @@
+// Benchmarks the colour conversion kernels and the converter registry's LUT path against the scalar reference
+// and checks they match it byte for byte, then does the same for row-parallel conversion per thread count.
+// Build with: yarn cmake --CDBUILD_CONVERT_BENCH=ON, then run build/Release/convert-bench [iterations]
+
+#include "converter_registry.h"
+#include "parallel_convert.h"
+#include "pixel_convert.h"
+
+#include <linux/videodev2.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr size_t kGuardBytes = 64;
+    constexpr uint8_t kGuardValue = 0xA5;
+
+    using Convert = std::function<void(const uint8_t* src, uint8_t* dst, int width, int height)>;
+
+    struct Resolution {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    struct Format {
+        const char* name;
+        // Source bytes per pixel times two, NV12 is 1.5 bytes per pixel
+        int doubledBytesPerPixel;
+        uint32_t pixelFormat;
+        RowKernel ConvertKernels::*kernel;
+    };
+
+    struct Candidate {
+        const char* name;
+        Convert convert;
+    };
+
+    double MeasureMs(const Convert& convert, const std::vector<uint8_t>& src, std::vector<uint8_t>& dst,
+                     const Resolution& res, int iterations) {
+        convert(src.data(), dst.data(), res.width, res.height);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            convert(src.data(), dst.data(), res.width, res.height);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 50;
+
+    const Resolution resolutions[] = {
+        {"650x362", 650, 362},
+        {"640x480", 640, 480},
+        {"1080p", 1920, 1080},
+        {"4K", 3840, 2160},
+    };
+    const Format formats[] = {
+        {"YUYV", 4, V4L2_PIX_FMT_YUYV, &ConvertKernels::yuyvToRgb},
+        {"NV12", 3, V4L2_PIX_FMT_NV12, &ConvertKernels::nv12ToRgb},
+        {"GREY", 2, V4L2_PIX_FMT_GREY, &ConvertKernels::greyToRgb},
+    };
+
+    const ConvertKernels& scalar = GetScalarConvertKernels();
+    std::printf("Dispatch selects: %s, %d iterations per case\n\n", GetConvertKernels().name, iterations);
+    std::printf("%-8s %-6s %-8s %10s %10s %8s\n", "Size", "Format", "Kernel", "ms/frame", "MPix/s", "Speedup");
+
+    std::mt19937 random(42);
+    bool mismatch = false;
+
+    for (const auto& res : resolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        for (const auto& format : formats) {
+            std::vector<uint8_t> src(pixels * format.doubledBytesPerPixel / 2);
+            for (auto& byte : src) {
+                byte = static_cast<uint8_t>(random());
+            }
+
+            std::vector<Candidate> candidates;
+            for (const ConvertKernels* kernels : GetSupportedConvertKernels()) {
+                RowKernel kernel = kernels->*format.kernel;
+                candidates.push_back({kernels->name, [kernel](const uint8_t* src, uint8_t* dst, int width, int height) {
+                    kernel(src, dst, width, height, 0, height);
+                }});
+            }
+            const PixelConverter* converter = FindPixelConverter(format.pixelFormat);
+            candidates.push_back({"lut", [converter](const uint8_t* src, uint8_t* dst, int width, int height) {
+                converter->rgb(src, dst, width, height, 1, 0, height);
+            }});
+
+            std::vector<uint8_t> expected(pixels * 3);
+            RowKernel scalarKernel = scalar.*format.kernel;
+            const double scalarMs = MeasureMs([scalarKernel](const uint8_t* src, uint8_t* dst, int width, int height) {
+                scalarKernel(src, dst, width, height, 0, height);
+            }, src, expected, res, iterations);
+
+            for (const auto& candidate : candidates) {
+                // Trailing guard bytes catch kernels that store past the last pixel
+                std::vector<uint8_t> actual(pixels * 3 + kGuardBytes, kGuardValue);
+                const double ms = MeasureMs(candidate.convert, src, actual, res, iterations);
+                if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+                    std::printf("MISMATCH: %s %s %s differs from scalar\n", res.name, format.name, candidate.name);
+                    mismatch = true;
+                }
+                for (size_t i = expected.size(); i < actual.size(); ++i) {
+                    if (actual[i] != kGuardValue) {
+                        std::printf("OVERRUN: %s %s %s wrote past the frame\n", res.name, format.name, candidate.name);
+                        mismatch = true;
+                        break;
+                    }
+                }
+                std::printf("%-8s %-6s %-8s %10.3f %10.1f %7.2fx\n", res.name, format.name, candidate.name,
+                            ms, static_cast<double>(pixels) / ms / 1000.0, scalarMs / ms);
+            }
+        }
+    }
+
+    // At least 4 threads so band splitting is checked on small machines too
+    const unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    std::printf("\n%-8s %-6s %-8s %10s %10s %8s %10s\n", "Size", "Format", "Threads", "ms/frame", "MPix/s", "Speedup",
+                "maxBandMs");
+    for (const auto& res : resolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        for (const auto& format : formats) {
+            std::vector<uint8_t> src(pixels * format.doubledBytesPerPixel / 2);
+            for (auto& byte : src) {
+                byte = static_cast<uint8_t>(random());
+            }
+            const PixelConverter* converter = FindPixelConverter(format.pixelFormat);
+
+            std::vector<uint8_t> expected(pixels * 3);
+            double serialMs = 0;
+            for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+                ParallelConverter parallel(static_cast<int>(threads));
+                std::vector<uint8_t> actual(pixels * 3);
+                const double ms = MeasureMs([&](const uint8_t* src, uint8_t* dst, int width, int height) {
+                    parallel.Convert(*converter, src, dst, width, height, 3, 1);
+                }, src, threads == 1 ? expected : actual, res, iterations);
+                if (threads == 1) {
+                    serialMs = ms;
+                } else if (expected != actual) {
+                    std::printf("MISMATCH: %s %s on %u threads differs from serial\n", res.name, format.name, threads);
+                    mismatch = true;
+                }
+                const ParallelConvertStats stats = parallel.GetStats();
+                std::printf("%-8s %-6s %-8u %10.3f %10.1f %7.2fx %10.3f%s\n", res.name, format.name, threads, ms,
+                            static_cast<double>(pixels) / ms / 1000.0, serialMs / ms, stats.maxBandMs,
+                            stats.parallelFrames == 0 ? " (serial)" : "");
+            }
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
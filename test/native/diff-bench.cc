@@ -0,0 +1,195 @@
+// Benchmarks the pixel diff kernels against the scalar reference and checks they count exactly the same
+// pixels, for every threshold on odd sized frames and at frame sizes the detector sees. The difference
+// histogram is checked to give the same count for every threshold too, and per tile counts against a
+// pixel by pixel walk of each tile.
+// Build with: yarn cmake --CDBUILD_DIFF_BENCH=ON, then run build/Release/diff-bench [iterations]
+
+#include "image_diff.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Resolution {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    struct Layout {
+        const char* name;
+        int channels;
+        DiffKernel DiffKernels::*kernel;
+        void (*histogram)(const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t* bins);
+    };
+
+    // Second frame is the first with noise on a fraction of the bytes, like two frames of a mostly still scene
+    void FillFrames(std::mt19937& random, std::vector<uint8_t>& a, std::vector<uint8_t>& b) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = static_cast<uint8_t>(random());
+            b[i] = random() % 4 == 0 ? static_cast<uint8_t>(random()) : a[i];
+        }
+    }
+
+    double MeasureMs(DiffKernel kernel, const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, size_t pixels,
+                     int threshold, int iterations, size_t& result) {
+        result = kernel(a.data(), b.data(), pixels, threshold);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            result = kernel(a.data(), b.data(), pixels, threshold);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    }
+
+    // Reference tile counts, one scalar call per pixel
+    std::vector<uint16_t> ReferenceTiles(const Layout& layout, const std::vector<uint8_t>& a,
+                                         const std::vector<uint8_t>& b, int width, int height, int threshold,
+                                         int tileSize) {
+        const int columns = (width + tileSize - 1) / tileSize;
+        const int rows = (height + tileSize - 1) / tileSize;
+        std::vector<uint16_t> tiles(static_cast<size_t>(columns) * rows);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t offset = (static_cast<size_t>(y) * width + x) * layout.channels;
+                tiles[static_cast<size_t>(y / tileSize) * columns + x / tileSize] += static_cast<uint16_t>(
+                    (GetScalarDiffKernels().*layout.kernel)(a.data() + offset, b.data() + offset, 1, threshold));
+            }
+        }
+        return tiles;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 100;
+
+    const Resolution resolutions[] = {
+        {"650x362", 650, 362},
+        {"640x480", 640, 480},
+        {"1080p", 1920, 1080},
+        {"4K", 3840, 2160},
+    };
+    const Layout layouts[] = {
+        {"RGB", 3, &DiffKernels::countRgb, DiffHistogramRgb},
+        {"luma", 1, &DiffKernels::countLuma, DiffHistogramLuma},
+    };
+
+    const DiffKernels& scalar = GetScalarDiffKernels();
+    const std::vector<const DiffKernels*> supported = GetSupportedDiffKernels();
+    std::mt19937 random(42);
+    bool mismatch = false;
+
+    // Every threshold, including the ones outside 0..254 vector kernels short-circuit, on sizes that leave
+    // tails of every length
+    for (const auto& layout : layouts) {
+        for (size_t pixels : {0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 47u, 65u, 100003u}) {
+            std::vector<uint8_t> a(pixels * layout.channels);
+            std::vector<uint8_t> b(a.size());
+            FillFrames(random, a, b);
+            uint32_t bins[kDiffHistogramBins];
+            layout.histogram(a.data(), b.data(), pixels, bins);
+            for (int threshold = -1; threshold <= 256; ++threshold) {
+                const size_t expected = (scalar.*layout.kernel)(a.data(), b.data(), pixels, threshold);
+                if (CountFromDiffHistogram(bins, threshold) != expected) {
+                    std::printf("MISMATCH: %s histogram %zu pixels, threshold %d: %zu instead of %zu\n", layout.name,
+                                pixels, threshold, CountFromDiffHistogram(bins, threshold), expected);
+                    mismatch = true;
+                }
+                for (const DiffKernels* kernels : supported) {
+                    const size_t actual = (kernels->*layout.kernel)(a.data(), b.data(), pixels, threshold);
+                    if (actual != expected) {
+                        std::printf("MISMATCH: %s %s %zu pixels, threshold %d: %zu instead of %zu\n", layout.name,
+                                    kernels->name, pixels, threshold, actual, expected);
+                        mismatch = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // Frames that leave partial tiles on both edges, and tiles narrower and wider than a vector block
+    for (const auto& layout : layouts) {
+        for (const Resolution& res : {Resolution{"37x23", 37, 23}, Resolution{"650x362", 650, 362}}) {
+            std::vector<uint8_t> a(static_cast<size_t>(res.width) * res.height * layout.channels);
+            std::vector<uint8_t> b(a.size());
+            FillFrames(random, a, b);
+            for (int tileSize : {1, 4, 16, 17, 32, 48, kMaxDiffTileSize}) {
+                const std::vector<uint16_t> expected =
+                    ReferenceTiles(layout, a, b, res.width, res.height, 25, tileSize);
+                for (const DiffKernels* kernels : supported) {
+                    std::vector<uint16_t> tiles(expected.size());
+                    const size_t total = CountDiffTiles(kernels->*layout.kernel, a.data(), b.data(), res.width,
+                                                        res.height, layout.channels, 25, tileSize, tiles.data());
+                    const size_t expectedTotal = (scalar.*layout.kernel)(
+                        a.data(), b.data(), static_cast<size_t>(res.width) * res.height, 25);
+                    if (tiles != expected || total != expectedTotal) {
+                        std::printf("MISMATCH: %s %s %s tiles of %d\n", res.name, layout.name, kernels->name,
+                                    tileSize);
+                        mismatch = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // diff.threshold defaults to 0.1, 25 on the byte scale
+    const int threshold = 25;
+    std::printf("Dispatch selects: %s, %d iterations per case, threshold %d\n\n", GetDiffKernels().name, iterations,
+                threshold);
+    std::printf("%-8s %-6s %-9s %10s %10s %8s\n", "Size", "Layout", "Kernel", "ms/frame", "GB/s", "Speedup");
+
+    for (const auto& res : resolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        for (const auto& layout : layouts) {
+            std::vector<uint8_t> a(pixels * layout.channels);
+            std::vector<uint8_t> b(a.size());
+            FillFrames(random, a, b);
+
+            size_t expected = 0;
+            const double scalarMs = MeasureMs(scalar.*layout.kernel, a, b, pixels, threshold, iterations, expected);
+            for (const DiffKernels* kernels : supported) {
+                size_t actual = 0;
+                const double ms = MeasureMs(kernels->*layout.kernel, a, b, pixels, threshold, iterations, actual);
+                if (actual != expected) {
+                    std::printf("MISMATCH: %s %s %s counted %zu instead of %zu\n", res.name, layout.name,
+                                kernels->name, actual, expected);
+                    mismatch = true;
+                }
+                // Both frames are read once
+                const double gbPerSecond = static_cast<double>(a.size() * 2) / ms / 1e6;
+                std::printf("%-8s %-6s %-9s %10.3f %10.2f %7.2fx\n", res.name, layout.name, kernels->name, ms,
+                            gbPerSecond, scalarMs / ms);
+            }
+
+            uint32_t bins[kDiffHistogramBins];
+            layout.histogram(a.data(), b.data(), pixels, bins);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                layout.histogram(a.data(), b.data(), pixels, bins);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count() / iterations;
+            std::printf("%-8s %-6s %-9s %10.3f %10.2f %7.2fx\n", res.name, layout.name, "histogram", ms,
+                        static_cast<double>(a.size() * 2) / ms / 1e6, scalarMs / ms);
+
+            // The heatmap pass, 16x16 tiles through the dispatched kernels
+            std::vector<uint16_t> tiles(static_cast<size_t>((res.width + 15) / 16) * ((res.height + 15) / 16));
+            const DiffKernel kernel = GetDiffKernels().*layout.kernel;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                CountDiffTiles(kernel, a.data(), b.data(), res.width, res.height, layout.channels, threshold, 16,
+                               tiles.data());
+            }
+            const double tileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count() / iterations;
+            std::printf("%-8s %-6s %-9s %10.3f %10.2f %7.2fx\n", res.name, layout.name, "tiles/16", tileMs,
+                        static_cast<double>(a.size() * 2) / tileMs / 1e6, scalarMs / tileMs);
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -110,6 +110,17 @@ describe('ReaderConfigService', () => {
       expect(fieldNames).toContain('diff.threshold');
     });
 
+    it('should not ask for optional fields', () => {
+      const questions: any[] = [];
+      (service as any).addQuestions('', aconfigSchema, questions, []);
+
+      const fieldNames = questions.map((q: any) => q.name);
+      expect(fieldNames).not.toContain('camera.bufferCount');
+      expect(fieldNames).not.toContain('camera.latestFrameOnly');
+      expect(fieldNames).not.toContain('camera.minWidth');
+      expect(fieldNames).not.toContain('diff.scanOrder');
+    });
+
     it('should use correct types for different field types', () => {
       const questions: any[] = [];
       (service as any).addQuestions('', aconfigSchema, questions, []);
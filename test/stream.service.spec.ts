@@ -1,7 +1,7 @@
 import { Test, TestingModule } from '@nestjs/testing';
 import { Logger } from '@nestjs/common';
 import { StreamService } from '../src/stream/stream-service';
-import { INativeModule, Native } from '../src/native/native-model';
+import { INativeModule, Native, NativeCaptureEvent } from '../src/native/native-model';
 import { CameraConfData } from '../src/config/config-resolve-model';
 import { CameraConfig } from '../src/config/config-zod-schema';
 import type { FrameDetector } from '../src/app/app-model';
@@ -86,7 +86,21 @@ describe('StreamService', () => {
       expect(mockCaptureService.start).toHaveBeenCalledWith(
         mockCameraConfig.name,
         mockCameraConfig.frameRate,
-        expect.any(Function)
+        expect.any(Function),
+        {
+          bufferCount: undefined,
+          latestFrameOnly: undefined,
+          minWidth: undefined,
+          minHeight: undefined,
+          decodeScale: undefined,
+          grayscale: undefined,
+          dctDetection: undefined,
+          conversionThreads: undefined,
+          stallTimeoutMs: undefined,
+          userPtr: undefined,
+          rawFrames: undefined,
+        },
+        expect.any(Function),
       );
       expect(mockLogger.log).toHaveBeenCalledWith(
         `DirectShow capture started for device: ${mockCameraConfig.name}`
@@ -96,6 +110,30 @@ describe('StreamService', () => {
       expect(jest.getTimerCount()).toBeGreaterThan(0);
     });
 
+    it('should pass capture tunables from config to native', () => {
+      mockCameraConfig.bufferCount = 2;
+      mockCameraConfig.latestFrameOnly = true;
+      mockCameraConfig.minWidth = 640;
+      mockCameraConfig.minHeight = 360;
+      mockCameraConfig.decodeScale = 4;
+      mockCameraConfig.grayscale = true;
+      mockCameraConfig.dctDetection = true;
+      mockCameraConfig.conversionThreads = 4;
+      mockCameraConfig.stallTimeoutMs = 1500;
+      mockCameraConfig.userPtr = true;
+      mockCameraConfig.rawFrames = 2;
+
+      service.listen(mockFrameListener);
+
+      expect(mockCaptureService.start).toHaveBeenCalledWith(
+        mockCameraConfig.name,
+        mockCameraConfig.frameRate,
+        expect.any(Function),
+        {bufferCount: 2, latestFrameOnly: true, minWidth: 640, minHeight: 360, decodeScale: 4, grayscale: true, dctDetection: true, conversionThreads: 4, stallTimeoutMs: 1500, userPtr: true, rawFrames: 2},
+        expect.any(Function),
+      );
+    });
+
     it('should handle frame data and reset timeout', async () => {
       let captureCallback: (frameInfo: any) => void | undefined;
       const mockFrameData = {
@@ -154,6 +192,26 @@ describe('StreamService', () => {
       }).toThrow('Frame capturing didn\'t produce any data for 5s, exiting...');
     });
 
+    it('should not exit while the native watchdog reconnects the camera', () => {
+      let eventCallback: (event: NativeCaptureEvent) => void;
+
+      mockCaptureService.start.mockImplementation((deviceName, frameRate, callback, options, onEvent) => {
+        eventCallback = onEvent!;
+      });
+
+      service.listen(mockFrameListener);
+      eventCallback!({type: 'lost', device: '/dev/video0', attempt: 0, durationMs: 0, message: 'No frame for 2000ms'});
+      eventCallback!({type: 'retry', device: '/dev/video0', attempt: 1, durationMs: 1, message: 'Device is not present'});
+
+      expect(() => jest.advanceTimersByTime(60000)).not.toThrow();
+      expect(mockLogger.warn).toHaveBeenCalledWith('Lost camera /dev/video0: No frame for 2000ms, reconnecting');
+
+      eventCallback!({type: 'reconnected', device: '/dev/video1', attempt: 2, durationMs: 310.4});
+
+      expect(mockLogger.log).toHaveBeenCalledWith('Reconnected to /dev/video1 after 2 attempts in 310ms');
+      expect(() => jest.advanceTimersByTime(5000)).toThrow('Frame capturing didn\'t produce any data for 5s, exiting...');
+    });
+
     it('should reset timeout on each frame received', async () => {
       let captureCallback: (frameInfo: any) => void | undefined;
       const mockFrameData = {
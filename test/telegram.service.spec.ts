@@ -50,6 +50,7 @@ describe('TelegramService', () => {
       onSetThreshold: jest.fn(),
       onIncreaseThreshold: jest.fn(),
       onDecreaseThreshold: jest.fn(),
+      onSetSensitivity: jest.fn(),
       onNewFrame: jest.fn(),
     } as any;
 
@@ -104,11 +105,16 @@ describe('TelegramService', () => {
           command: TelegramCommands.decrease_threshold,
           description: 'Reduces the amount of pixels related to current value to spot a diff',
         },
+        {
+          command: TelegramCommands.set_sensitivity,
+          description: 'Sets how much a pixel has to change to count, from 0 to 1, lower = more aggressive',
+        },
       ]);
       expect(mockBot.command).toHaveBeenCalledWith(TelegramCommands.image, expect.any(Function));
       expect(mockBot.command).toHaveBeenCalledWith(TelegramCommands.set_threshold, expect.any(Function));
       expect(mockBot.command).toHaveBeenCalledWith(TelegramCommands.increase_threshold, expect.any(Function));
       expect(mockBot.command).toHaveBeenCalledWith(TelegramCommands.decrease_threshold, expect.any(Function));
+      expect(mockBot.command).toHaveBeenCalledWith(TelegramCommands.set_sensitivity, expect.any(Function));
       expect(mockBot.launch).toHaveBeenCalled();
     });
 
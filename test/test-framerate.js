@@ -4,17 +4,20 @@ const bindings = require('bindings');
 const deviceName = process.argv[2] || '/dev/video0';
 const targetFps = Number(process.argv[3] || 2);
 const testDurationSeconds = Number(process.argv[4] || 10);
+// Max allowed |interval - expected| in ms, defaults to 20% of the expected interval
+const jitterBoundArg = Number(process.argv[5] || 0);
 
 if (!targetFps || targetFps <= 0) {
   console.error('FPS must be a positive number.');
-  console.error('Usage: node test-framerate.js [device] [fps] [duration]');
-  console.error('Example: node test-framerate.js /dev/video0 1 10');
+  console.error('Usage: node test-framerate.js [device] [fps] [duration] [jitterBoundMs]');
+  console.error('Example: node test-framerate.js /dev/video0 0.5 20 50');
   process.exit(1);
 }
 
 const capture = bindings('native');
 const testDurationMs = testDurationSeconds * 1000;
 const expectedInterval = 1000 / targetFps; // Expected milliseconds between frames
+const jitterBoundMs = jitterBoundArg > 0 ? jitterBoundArg : expectedInterval * 0.2;
 
 console.log('🎬 Framerate Test Starting');
 console.log('========================');
@@ -22,12 +25,15 @@ console.log(`📹 Device: ${deviceName}`);
 console.log(`🎯 Target FPS: ${targetFps}`);
 console.log(`⏱️  Expected interval: ${expectedInterval.toFixed(2)}ms`);
 console.log(`⏰ Test duration: ${testDurationSeconds}s`);
+console.log(`📐 Jitter bound: ${jitterBoundMs.toFixed(2)}ms`);
 console.log('');
 
 let frameCount = 0;
 let lastFrameTime = 0;
 const intervals = [];
 const timestamps = [];
+// Native pacing lateness reported by the capture thread (linux only)
+const nativeLateness = [];
 let startTime = 0;
 
 // Statistics tracking
@@ -65,14 +71,27 @@ const analyzeFramerate = () => {
   console.log(`⬆️  Max Interval: ${maxInterval.toFixed(2)}ms`);
   console.log('');
 
+  // Jitter: absolute deviation of each interval from the target
+  const jitters = intervals.map((interval) => Math.abs(interval - expectedInterval)).sort((a, b) => a - b);
+  const p95Jitter = jitters[Math.min(jitters.length - 1, Math.floor(jitters.length * 0.95))];
+  const maxJitter = jitters[jitters.length - 1];
+  console.log(`〰️  Jitter p95: ${p95Jitter.toFixed(2)}ms, max: ${maxJitter.toFixed(2)}ms (bound ${jitterBoundMs.toFixed(2)}ms)`);
+  if (nativeLateness.length > 0) {
+    const maxLate = Math.max(...nativeLateness.map(Math.abs));
+    console.log(`🕰️  Native pacing lateness max: ${maxLate.toFixed(2)}ms over ${nativeLateness.length} frames`);
+  }
+  console.log('');
+
   // Test results
   const isAccurate = fpsDeviationPercent < 10; // Within 10% is considered good
   const isStable = stdDev < (expectedInterval * 0.2); // Standard deviation < 20% of expected interval
+  const isJitterBounded = maxJitter <= jitterBoundMs;
 
   console.log('🧪 Test Results');
   console.log('===============');
   console.log(`${isAccurate ? '✅' : '❌'} FPS Accuracy: ${isAccurate ? 'PASS' : 'FAIL'} (${fpsDeviationPercent.toFixed(1)}% deviation)`);
   console.log(`${isStable ? '✅' : '❌'} FPS Stability: ${isStable ? 'PASS' : 'FAIL'} (${stdDev.toFixed(2)}ms std dev)`);
+  console.log(`${isJitterBounded ? '✅' : '❌'} Jitter Bound: ${isJitterBounded ? 'PASS' : 'FAIL'} (${maxJitter.toFixed(2)}ms max)`);
   
   if (frameCount > 0) {
     const totalTime = timestamps[timestamps.length - 1] - timestamps[0];
@@ -93,7 +112,10 @@ const analyzeFramerate = () => {
   if (!isStable) {
     console.log('⚠️  Unstable framerate - check system load and camera capabilities');
   }
-  if (isAccurate && isStable) {
+  if (!isJitterBounded) {
+    console.log('⚠️  Interval jitter exceeds the bound - check conversion time and JS event loop load');
+  }
+  if (isAccurate && isStable && isJitterBounded) {
     console.log('🎉 Framerate control is working correctly!');
   }
 };
@@ -131,6 +153,9 @@ capture.start(deviceName, targetFps, (frameData) => {
   
   frameCount++;
   timestamps.push(now);
+  if (frameData && typeof frameData.lateMs === 'number') {
+    nativeLateness.push(frameData.lateMs);
+  }
   
   // Calculate interval from previous frame
   if (lastFrameTime > 0) {